@@ -0,0 +1,85 @@
+// Call rate of many caller threads sharing a client context, per number of I/O threads.
+// Build with `make bench`.
+// Usage: concurrent [calls per caller] [callers]
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <ox/ox.hpp>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	using function_type = void(std::uint64_t, std::function<void(std::uint64_t)>);
+
+	using clock_type = std::chrono::steady_clock;
+
+	// each caller keeps `window` calls in flight until it has made `calls`
+	void run(std::size_t io_threads, std::size_t callers, std::size_t calls, std::size_t window)
+	{
+		ox::io_options options;
+		options.threads = io_threads;
+
+		auto context = std::make_shared<ox::client_context>(options);
+		ox::client<function_type> client(context, "localhost");
+
+		std::atomic<std::size_t> completed(0);
+		std::promise<void> done;
+
+		auto start = clock_type::now();
+
+		std::vector<std::thread> threads;
+
+		for (std::size_t t = 0; t < callers; ++t)
+		{
+			threads.emplace_back([&]() {
+				std::atomic<std::size_t> in_flight(0);
+
+				for (std::size_t i = 0; i < calls; ++i)
+				{
+					while (in_flight >= window)
+						std::this_thread::yield();
+
+					++in_flight;
+
+					client(i, [&](std::uint64_t /*index*/) {
+						--in_flight;
+
+						if (++completed == callers * calls)
+							done.set_value();
+					});
+				}
+
+				while (in_flight != 0)
+					std::this_thread::yield();
+			});
+		}
+
+		done.get_future().wait();
+
+		auto seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+
+		for (auto& thread : threads)
+			thread.join();
+
+		std::cout
+			<< io_threads << " I/O threads, " << callers << " callers: "
+			<< static_cast<std::uint64_t>(callers * calls / seconds) << " calls/s"
+			<< std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::size_t calls = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 20000;
+	std::size_t callers = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 32;
+
+	ox::server<function_type> server([](std::uint64_t index, std::function<void(std::uint64_t)> f) {
+		f(index);
+	});
+
+	for (std::size_t io_threads : {1, 2, 4, 8})
+		run(io_threads, callers, calls, 64);
+}
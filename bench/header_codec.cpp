@@ -0,0 +1,198 @@
+// Encoding and decoding of frame headers, compared with the byte at a time codec which the
+// frame format used before. Build with `make bench`.
+// Usage: header_codec [frames]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <ox/detail/frame.hpp>
+#include <random>
+#include <vector>
+
+namespace
+{
+	using clock_type = std::chrono::steady_clock;
+
+	namespace legacy
+	{
+		using ox::detail::parse_result;
+
+		void write_integer(std::vector<char>& buffer, std::uint64_t value)
+		{
+			if (value < 0x80)
+			{
+				buffer.push_back(static_cast<char>(value));
+				return;
+			}
+
+			std::size_t size = value < 0x100 ? 1 : value < 0x10000 ? 2 : value < 0x100000000 ? 4 : 8;
+
+			buffer.push_back(static_cast<char>(size == 1 ? 0xcc : size == 2 ? 0xcd : size == 4 ? 0xce : 0xcf));
+
+			for (auto i = size; i-- > 0;)
+				buffer.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+		}
+
+		parse_result parse_integer(const char*& p, const char* end, std::uint64_t& value)
+		{
+			if (p == end)
+				return parse_result::incomplete;
+
+			auto type = static_cast<std::uint8_t>(*p);
+
+			if (type < 0x80)
+			{
+				value = type;
+				++p;
+				return parse_result::complete;
+			}
+
+			std::size_t size;
+
+			switch (type)
+			{
+			case 0xcc:
+				size = 1;
+				break;
+			case 0xcd:
+				size = 2;
+				break;
+			case 0xce:
+				size = 4;
+				break;
+			case 0xcf:
+				size = 8;
+				break;
+			default:
+				return parse_result::invalid;
+			}
+
+			if (static_cast<std::size_t>(end - p) < 1 + size)
+				return parse_result::incomplete;
+
+			auto q = reinterpret_cast<const std::uint8_t*>(p + 1);
+
+			value = 0;
+			for (std::size_t i = 0; i < size; ++i)
+				value = (value << 8) | q[i];
+
+			p += 1 + size;
+
+			return parse_result::complete;
+		}
+	}
+
+	struct frame
+	{
+		std::uint64_t id;
+		std::uint64_t size;
+	};
+
+	// callback ids are small, sizes are mostly small with a tail of larger ones
+	std::vector<frame> generate(std::size_t count)
+	{
+		std::mt19937_64 random(42);
+		std::vector<frame> frames(count);
+
+		for (auto& f : frames)
+		{
+			f.id = random() % 1000;
+
+			auto r = random() % 100;
+			f.size = r < 70 ? random() % 0x80 : r < 95 ? random() % 0x10000 : random() % 0x1000000;
+		}
+
+		return frames;
+	}
+
+	template <class F>
+	void measure(const char* name, std::size_t count, F f)
+	{
+		// the checksum keeps the work from being optimized away
+		std::uint64_t checksum = 0;
+
+		auto start = clock_type::now();
+		for (int i = 0; i < 10; ++i)
+			checksum += f();
+		auto seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+
+		std::cout << name << ": " << seconds * 1e9 / (10.0 * count) << " ns/header (" << checksum % 10 << ")" << std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+
+	auto frames = generate(count);
+
+	std::vector<char> buffer;
+	buffer.reserve(count * 2 * ox::detail::max_integer_size);
+
+	measure("encode legacy", count, [&]() {
+		buffer.clear();
+
+		for (const auto& f : frames)
+		{
+			legacy::write_integer(buffer, f.id);
+			legacy::write_integer(buffer, f.size);
+		}
+
+		return buffer.size();
+	});
+
+	std::vector<char> encoded(count * 2 * ox::detail::max_integer_size + ox::detail::max_integer_size);
+	std::size_t encoded_size = 0;
+
+	measure("encode", count, [&]() {
+		auto p = encoded.data();
+
+		for (const auto& f : frames)
+		{
+			p = ox::detail::encode_integer(p, f.id);
+			p = ox::detail::encode_integer(p, f.size);
+		}
+
+		encoded_size = static_cast<std::size_t>(p - encoded.data());
+		return encoded_size;
+	});
+
+	if (encoded_size != buffer.size() || !std::equal(buffer.begin(), buffer.end(), encoded.begin()))
+	{
+		std::cerr << "the encodings differ" << std::endl;
+		return 1;
+	}
+
+	const char* begin = buffer.data();
+	const char* end = buffer.data() + buffer.size();
+
+	measure("decode legacy", count, [&]() {
+		std::uint64_t sum = 0;
+		std::uint64_t id = 0;
+		std::uint64_t size = 0;
+
+		for (auto p = begin; p != end;)
+		{
+			legacy::parse_integer(p, end, id);
+			legacy::parse_integer(p, end, size);
+			sum += id + size;
+		}
+
+		return sum;
+	});
+
+	measure("decode", count, [&]() {
+		std::uint64_t sum = 0;
+		ox::detail::frame_header header;
+
+		for (auto p = begin; p != end;)
+		{
+			ox::detail::parse_header(p, end, header);
+			p += header.length;
+			sum += header.id + header.size;
+		}
+
+		return sum;
+	});
+}
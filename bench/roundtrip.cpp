@@ -0,0 +1,126 @@
+// Round trip throughput and latency between a host and a client on localhost.
+// Build with `make bench` and `make bench io_uring=1` to compare the backends.
+// Usage: roundtrip [calls] [busy poll budget in microseconds, -1 to spin forever]
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <iostream>
+#include <mutex>
+#include <ox/ox.hpp>
+#include <vector>
+
+namespace
+{
+	using function_type = void(std::uint64_t, ox::string_view, std::function<void(std::uint64_t)>);
+
+	using clock_type = std::chrono::steady_clock;
+
+	double percentile(std::vector<double>& values, double p)
+	{
+		if (values.empty())
+			return 0;
+
+		auto n = static_cast<std::size_t>(p * (values.size() - 1));
+		std::nth_element(values.begin(), values.begin() + n, values.end());
+
+		return values[n];
+	}
+
+	// keeps `window` calls in flight until `calls` have completed
+	void run(ox::client<function_type>& client, std::size_t calls, std::size_t window, std::size_t payload_size)
+	{
+		std::string payload(payload_size, 'x');
+
+		std::mutex mutex;
+		std::vector<double> latencies;
+		latencies.reserve(calls);
+
+		std::size_t issued = 0;
+		std::size_t completed = 0;
+		std::promise<void> done;
+
+		std::function<void()> issue;
+
+		issue = [&]() {
+			std::size_t index;
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+
+				if (issued == calls)
+					return;
+
+				index = issued++;
+			}
+
+			auto start = clock_type::now();
+
+			client(index, payload, [&, start](std::uint64_t /*index*/) {
+				auto latency = std::chrono::duration<double, std::micro>(clock_type::now() - start).count();
+
+				bool finished;
+
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					latencies.push_back(latency);
+					finished = ++completed == calls;
+				}
+
+				if (finished)
+					done.set_value();
+				else
+					issue();
+			});
+		};
+
+		auto start = clock_type::now();
+
+		for (std::size_t i = 0; i < window; ++i)
+			issue();
+
+		done.get_future().wait();
+
+		auto seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+
+		std::cout
+			<< "payload " << payload_size << " B, window " << window << ": "
+			<< static_cast<std::uint64_t>(calls / seconds) << " calls/s, "
+			<< "p50 " << percentile(latencies, 0.5) << " us, "
+			<< "p99 " << percentile(latencies, 0.99) << " us, "
+			<< "p999 " << percentile(latencies, 0.999) << " us"
+			<< std::endl;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	std::size_t calls = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100000;
+	long long busy_poll = argc > 2 ? std::strtoll(argv[2], nullptr, 10) : 0;
+
+	ox::io_options options;
+	options.busy_poll = busy_poll < 0 ? std::chrono::microseconds::max() : std::chrono::microseconds(busy_poll);
+
+#if defined(OX_IO_URING)
+	std::cout << "backend: io_uring" << std::endl;
+#else
+	std::cout << "backend: epoll" << std::endl;
+#endif
+
+	std::cout << "busy poll: " << busy_poll << " us" << std::endl;
+
+	ox::server<function_type> server([](std::uint64_t index, ox::string_view /*payload*/, std::function<void(std::uint64_t)> f) {
+		f(index);
+	}, 21872, options);
+
+	ox::client<function_type> client("localhost", 21872, ox::service_id(), options);
+
+	// warm up the connection and the buffer pools
+	run(client, 1000, 16, 64);
+
+	for (std::size_t payload_size : {16, 1024, 64 * 1024})
+	{
+		for (std::size_t window : {1, 64})
+			run(client, calls, window, payload_size);
+	}
+}
@@ -0,0 +1,177 @@
+#pragma once
+#include "detail/frame.hpp"
+#include "view.hpp"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace ox
+{
+	struct captured_frame
+	{
+		// since the clock's epoch when recorded, since the first frame when read from a file
+		std::chrono::nanoseconds time{0};
+
+		// numbers the connections of a host or client context
+		std::uint64_t connection = 0;
+
+		bool received = false;
+
+		std::uint64_t id = 0;
+
+		// unregister frames have the maximum size and no payload
+		std::uint64_t size = 0;
+
+		// valid during record() or until the next frame is read
+		string_view payload;
+	};
+
+	class capture_sink
+	{
+	public:
+		virtual ~capture_sink() = default;
+
+		// called from I/O threads and from the threads which issue calls
+		virtual void record(const captured_frame& frame) = 0;
+	};
+
+	namespace detail
+	{
+		// "oxcap" and the format version
+		inline const std::array<char, 6>& get_capture_magic()
+		{
+			static const std::array<char, 6> magic = {{'o', 'x', 'c', 'a', 'p', 0x01}};
+			return magic;
+		}
+	}
+
+	// Writes frames to a file: the magic, then per frame the time since the previous frame
+	// in nanoseconds, connection, direction, id, size and payload, with integers as in frames
+	class capture_file : public capture_sink
+	{
+	public:
+		explicit capture_file(const std::string& path)
+			: os_(path, std::ios::binary | std::ios::trunc)
+		{
+			if (!os_)
+				throw std::runtime_error("cannot open " + path);
+
+			os_.write(detail::get_capture_magic().data(), detail::get_capture_magic().size());
+		}
+
+		void record(const captured_frame& frame) override
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+
+			// frames may be recorded slightly out of order by different threads
+			auto time = frame.time > last_ ? frame.time : last_;
+			auto delta = first_ ? std::chrono::nanoseconds(0) : time - last_;
+
+			first_ = false;
+			last_ = time;
+
+			buffer_.clear();
+			detail::write_integer(buffer_, static_cast<std::uint64_t>(delta.count()));
+			detail::write_integer(buffer_, frame.connection);
+			buffer_.push_back(static_cast<char>(frame.received ? 1 : 0));
+			detail::write_integer(buffer_, frame.id);
+			detail::write_integer(buffer_, frame.size);
+
+			os_.write(buffer_.data(), buffer_.size());
+			os_.write(frame.payload.data(), frame.payload.size());
+		}
+
+		void flush()
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			os_.flush();
+		}
+
+	private:
+		std::mutex mutex_;
+		std::ofstream os_;
+		std::vector<char> buffer_;
+		std::chrono::nanoseconds last_{0};
+		bool first_ = true;
+	};
+
+	// Reads a file written by capture_file
+	class capture_reader
+	{
+	public:
+		explicit capture_reader(const std::string& path)
+		{
+			std::ifstream is(path, std::ios::binary);
+			if (!is)
+				throw std::runtime_error("cannot open " + path);
+
+			data_.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+
+			const auto& magic = detail::get_capture_magic();
+
+			if (data_.size() < magic.size() || !std::equal(magic.begin(), magic.end(), data_.begin()))
+				throw std::runtime_error(path + " is not a capture");
+
+			position_ = magic.size();
+		}
+
+		// false at the end of the file; throws std::runtime_error if the file is truncated
+		bool next(captured_frame& frame)
+		{
+			if (position_ == data_.size())
+				return false;
+
+			const char* p = data_.data() + position_;
+			const char* end = data_.data() + data_.size();
+
+			std::uint64_t delta;
+			read_integer(p, end, delta);
+			read_integer(p, end, frame.connection);
+
+			if (p == end)
+				throw std::runtime_error("truncated capture");
+
+			frame.received = *p++ != 0;
+
+			read_integer(p, end, frame.id);
+			read_integer(p, end, frame.size);
+
+			std::size_t size = 0;
+
+			if (frame.size != std::numeric_limits<std::uint64_t>::max())
+			{
+				if (frame.size > static_cast<std::uint64_t>(end - p))
+					throw std::runtime_error("truncated capture");
+
+				size = static_cast<std::size_t>(frame.size);
+			}
+
+			frame.payload = string_view(p, size);
+			time_ += std::chrono::nanoseconds(delta);
+			frame.time = time_;
+
+			position_ = static_cast<std::size_t>(p + size - data_.data());
+
+			return true;
+		}
+
+	private:
+		static void read_integer(const char*& p, const char* end, std::uint64_t& value)
+		{
+			if (detail::decode_integer(p, end, value) != detail::parse_result::complete)
+				throw std::runtime_error("truncated capture");
+		}
+
+		std::vector<char> data_;
+		std::size_t position_ = 0;
+		std::chrono::nanoseconds time_{0};
+	};
+}
@@ -1,13 +1,22 @@
 #pragma once
+#include "capture.hpp"
+#include "client_context.hpp"
 #include "detail/archive.hpp"
+#include "detail/call.hpp"
 #include "detail/connection.hpp"
-#include <boost/asio.hpp>
+#include "detail/fingerprint.hpp"
+#include "detail/trace.hpp"
+#include "error.hpp"
+#include "io_options.hpp"
+#include "metrics.hpp"
+#include "priority.hpp"
+#include "service.hpp"
+#include "trace.hpp"
+#include "view.hpp"
 #include <boost/lexical_cast.hpp>
-#include <boost/optional.hpp>
-#include <condition_variable>
 #include <memory>
+#include <sstream>
 #include <string>
-#include <thread>
 
 namespace ox
 {
@@ -22,63 +31,73 @@ namespace ox
 
 		typedef std::function<void(Arguments...)> function_type;
 
-		explicit client(const char* host, unsigned short port = 21872)
-			: host_(host)
-			, port_(port)
+		explicit client(const char* host, unsigned short port = 21872, service_id service = service_id(), const io_options& options = io_options())
+			: client(std::make_shared<client_context>(options), host, port, service)
 		{
-			thread_ = std::thread(std::bind(&client::run, this));
 		}
 
-		~client()
+		// clients which share a context share its I/O threads and their connections
+		client(const std::shared_ptr<client_context>& context, const char* host, unsigned short port = 21872, service_id service = service_id())
+			: context_(context)
+			, host_(host)
+			, port_(port)
+			, key_(host_ + ":" + boost::lexical_cast<std::string>(port))
+			, service_(service)
 		{
-			io_service_.stop();
-			thread_.join();
 		}
 
 		template <class ErrorHandler>
 		void operator()(Arguments... args, ErrorHandler error_handler)
 		{
-			boost::asio::ip::tcp::resolver::query query(host_, boost::lexical_cast<std::string>(port_));
+			auto tracer = context_->tracer_;
+			auto parent = detail::tracer::current();
+			auto call = tracer->start("call", parent);
+			auto service = service_;
+			auto lane = priority_;
 
-			resolver_.async_resolve(query, [=](const auto& ec, auto it) {
+			// views among the arguments are copied since the call is sent later on the I/O thread
+			std::tuple<detail::owning_t<Arguments>...> values(detail::to_owning(args)...);
+
+			context_->connect(key_, host_, port_, call.context, [=](const auto& ec, const auto& c) {
 				if (ec)
 				{
 					error_handler(ec);
 					return;
 				}
 
-				auto c = std::make_shared<detail::connection>(io_service_, error_handler);
+				// a failure of the connection before the callbacks of the call are released reaches error_handler
+				auto call_id = c->track_call(error_handler);
+
+				auto serialize = tracer->start("serialize", call.context);
 
-				c->socket().async_connect(it->endpoint(), [=](const auto& ec) {
-					if (ec)
-					{
-						error_handler(ec);
-						return;
-					}
+				std::ostringstream os;
 
-					c->handshake_client([=](const auto& ec) {
-						if (ec)
-						{
-							error_handler(ec);
-							return;
-						}
+				{
+					detail::oarchive oa(os, c, lane, call_id);
 
-						std::ostringstream os;
+					detail::call_prologue prologue;
+					prologue.fingerprint = detail::fingerprint<function_type>();
+					prologue.error = [c, call_id](int value) {
+						c->fail_call(call_id, make_error_code(static_cast<errc>(value)));
+					};
 
-						{
-							detail::oarchive oa(os, c);
+					std::function<void(const function_type&)> receiver = [values](const auto& f) {
+						detail::apply(f, values);
+					};
 
-							std::function<void(const function_type&)> receiver = [=](const auto& f) {
-								f(args...);
-							};
+					oa(prologue, receiver);
+				}
 
-							oa(receiver);
-						}
+				tracer->finish(serialize);
 
-						c->invoke_remote(0, os.str());
-						c->receive(error_handler);
-					});
-				});
+				{
+					detail::trace_scope scope(call ? call.context : parent);
+					c->invoke_remote(service.value(), os.str(), [c, call_id](const auto& ec) {
+						c->fail_call(call_id, ec);
+					}, lane);
+				}
+
+				tracer->finish(call);
 			});
 		}
 
@@ -87,17 +106,50 @@ namespace ox
 			(*this)(args..., [](const auto&) {});
 		}
 
-	private:
-		void run()
+		// lane of subsequent calls and of the callbacks passed to them;
+		// clients which share a context may use different lanes on the same connection
+		void set_priority(priority lane)
 		{
-			io_service_.run();
+			priority_ = lane;
 		}
 
+		void enable_metrics(bool enable = true)
+		{
+			context_->enable_metrics(enable);
+		}
+
+		metrics_snapshot metrics() const
+		{
+			return context_->metrics();
+		}
+
+		// returns the sink so that the default ring buffer can be read back
+		std::shared_ptr<trace_sink> enable_tracing(std::shared_ptr<trace_sink> sink = std::make_shared<ring_buffer_trace_sink>())
+		{
+			return context_->enable_tracing(sink);
+		}
+
+		void disable_tracing()
+		{
+			context_->disable_tracing();
+		}
+
+		void enable_capture(const std::shared_ptr<capture_sink>& sink)
+		{
+			context_->enable_capture(sink);
+		}
+
+		void disable_capture()
+		{
+			context_->disable_capture();
+		}
+
+	private:
+		std::shared_ptr<client_context> context_;
 		std::string host_;
 		unsigned short port_;
-		boost::asio::io_service io_service_;
-		boost::asio::ip::tcp::resolver resolver_{io_service_};
-		std::unique_ptr<boost::asio::io_service::work> work_ = std::make_unique<boost::asio::io_service::work>(io_service_);
-		std::thread thread_;
+		std::string key_;
+		service_id service_;
+		priority priority_ = priority::normal;
 	};
 }
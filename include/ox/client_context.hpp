@@ -0,0 +1,331 @@
+#pragma once
+#include "capture.hpp"
+#include "detail/capture.hpp"
+#include "detail/connection.hpp"
+#include "detail/event_loop.hpp"
+#include "detail/metrics.hpp"
+#include "detail/mpsc_queue.hpp"
+#include "detail/slot_pool.hpp"
+#include "detail/trace.hpp"
+#include "io_options.hpp"
+#include "metrics.hpp"
+#include "trace.hpp"
+#include <atomic>
+#include <boost/asio.hpp>
+#include <boost/lexical_cast.hpp>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace ox
+{
+	template <class Function>
+	class client;
+
+	// I/O threads and connection pools shared by clients. Each thread keeps one connection per
+	// peer, and a caller thread always submits to the same I/O thread, so its calls stay in order.
+	class client_context
+	{
+	public:
+		explicit client_context(const io_options& options = io_options())
+			: options_(options)
+		{
+			auto count = options_.threads == 0 ? 1 : options_.threads;
+
+			for (std::size_t i = 0; i < count; ++i)
+				shards_.push_back(std::make_unique<shard>());
+
+			try
+			{
+				for (std::size_t i = 0; i < count; ++i)
+				{
+					auto& s = *shards_[i];
+					s.thread = std::thread(std::bind(&client_context::run, this, std::ref(s)));
+					detail::pin_thread(s.thread, options_.cpu < 0 ? -1 : options_.cpu + static_cast<int>(i));
+				}
+			}
+			catch (...)
+			{
+				stop();
+				slots().release(slot_);
+				throw;
+			}
+		}
+
+		~client_context()
+		{
+			stop();
+			slots().release(slot_);
+		}
+
+		client_context(const client_context&) = delete;
+		client_context& operator=(const client_context&) = delete;
+
+		void enable_metrics(bool enable = true)
+		{
+			metrics_->enable(enable);
+		}
+
+		metrics_snapshot metrics() const
+		{
+			return metrics_->snapshot();
+		}
+
+		// returns the sink so that the default ring buffer can be read back
+		std::shared_ptr<trace_sink> enable_tracing(std::shared_ptr<trace_sink> sink = std::make_shared<ring_buffer_trace_sink>())
+		{
+			tracer_->set_sink(sink);
+			return sink;
+		}
+
+		void disable_tracing()
+		{
+			tracer_->set_sink(nullptr);
+		}
+
+		// frames of all connections are passed to sink, including their payloads
+		void enable_capture(const std::shared_ptr<capture_sink>& sink)
+		{
+			capturer_->set_sink(sink);
+		}
+
+		void disable_capture()
+		{
+			capturer_->set_sink(nullptr);
+		}
+
+	private:
+		template <class Function>
+		friend class client;
+
+		typedef std::function<void(const boost::system::error_code&, const std::shared_ptr<detail::connection>&)> connect_handler;
+
+		struct peer
+		{
+			std::shared_ptr<detail::connection> connection;
+			std::vector<connect_handler> waiters;
+		};
+
+		// an I/O thread with its own connections
+		struct shard
+		{
+			boost::asio::io_service io_service;
+			boost::asio::ip::tcp::resolver resolver{io_service};
+			std::unique_ptr<boost::asio::io_service::work> work = std::make_unique<boost::asio::io_service::work>(io_service);
+			std::unordered_map<std::string, std::shared_ptr<peer>> peers;
+			std::thread thread;
+
+			// tasks submitted by other threads, drained by one handler posted per batch
+			detail::mpsc_queue<std::function<void()>> submitted;
+			std::atomic<bool> scheduled{false};
+		};
+
+		// drained tasks per handler, so that a steady stream of submissions does not starve reads
+		static const std::size_t max_drained = 256;
+
+		// calls handler on the I/O thread of the calling thread with the pooled connection, establishing it if needed;
+		// key is host:port
+		void connect(const std::string& key, const std::string& host, unsigned short port, const detail::trace_context& parent, const connect_handler& handler)
+		{
+			auto& s = local_shard();
+
+			submit(s, [=, &s]() {
+				auto& p = s.peers[key];
+
+				if (!p)
+					p = std::make_shared<peer>();
+
+				if (p->connection)
+				{
+					handler(boost::system::error_code(), p->connection);
+					return;
+				}
+
+				p->waiters.push_back(handler);
+
+				if (p->waiters.size() == 1)
+					establish(s, key, host, port, p, parent);
+			});
+		}
+
+		// threads are assigned to shards in turn on their first call, and keep their shard
+		shard& local_shard()
+		{
+			if (shards_.size() == 1)
+				return *shards_.front();
+
+			// indexed by slot; the id tells the assignment of a destroyed context which held the slot apart
+			thread_local std::vector<std::pair<std::uint64_t, std::size_t>> assigned;
+
+			if (assigned.size() <= slot_)
+				assigned.resize(slot_ + 1, std::make_pair(std::numeric_limits<std::uint64_t>::max(), std::size_t(0)));
+
+			auto& a = assigned[slot_];
+
+			if (a.first != id_)
+				a = std::make_pair(id_, next_shard_.fetch_add(1, std::memory_order_relaxed) % shards_.size());
+
+			return *shards_[a.second];
+		}
+
+		static std::uint64_t next_id()
+		{
+			static std::atomic<std::uint64_t> id{0};
+			return id.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		static detail::slot_pool& slots()
+		{
+			static detail::slot_pool pool;
+			return pool;
+		}
+
+		// only the submission which finds the queue unscheduled posts to the io_service
+		void submit(shard& s, std::function<void()> task)
+		{
+			s.submitted.push(std::move(task));
+
+			if (!s.scheduled.exchange(true))
+				s.io_service.post(std::bind(&client_context::drain, this, std::ref(s)));
+		}
+
+		void drain(shard& s)
+		{
+			// cleared first, so that a task pushed after the queue was found empty schedules another drain
+			s.scheduled.exchange(false, std::memory_order_acq_rel);
+
+			std::function<void()> task;
+			std::size_t drained = 0;
+
+			while (drained < max_drained && s.submitted.pop(task))
+			{
+				++drained;
+				task();
+			}
+
+			if (drained == max_drained && !s.scheduled.exchange(true))
+				s.io_service.post(std::bind(&client_context::drain, this, std::ref(s)));
+		}
+
+		void establish(shard& s, const std::string& key, const std::string& host, unsigned short port, const std::shared_ptr<peer>& p, const detail::trace_context& parent)
+		{
+			std::weak_ptr<peer> weak = p;
+
+			auto c = std::make_shared<detail::connection>(s.io_service, [=, &s](const auto& /*ec*/) {
+				this->evict(s, key, weak);
+			}, metrics_, tracer_);
+
+			c->capture(capturer_);
+
+			auto resolve = tracer_->start("resolve", parent);
+
+			boost::asio::ip::tcp::resolver::query query(host, boost::lexical_cast<std::string>(port));
+
+			s.resolver.async_resolve(query, [=, &s](const auto& ec, auto it) {
+				tracer_->finish(resolve);
+
+				if (ec)
+				{
+					this->fail(s, key, p, ec);
+					return;
+				}
+
+				auto connect = tracer_->start("connect", parent);
+
+				c->socket().async_connect(it->endpoint(), [=, &s](const auto& ec) {
+					tracer_->finish(connect);
+
+					if (ec)
+					{
+						this->fail(s, key, p, ec);
+						return;
+					}
+
+					c->configure(options_);
+
+					auto handshake = tracer_->start("handshake", parent);
+
+					c->handshake_client([=, &s](const auto& ec) {
+						tracer_->finish(handshake);
+
+						if (ec)
+						{
+							this->fail(s, key, p, ec);
+							return;
+						}
+
+						p->connection = c;
+
+						c->receive([=, &s](const auto& /*ec*/) {
+							this->evict(s, key, weak);
+						});
+
+						auto waiters = std::move(p->waiters);
+						p->waiters.clear();
+
+						for (const auto& waiter : waiters)
+							waiter(ec, c);
+					});
+				});
+			});
+		}
+
+		void fail(shard& s, const std::string& key, const std::shared_ptr<peer>& p, const boost::system::error_code& ec)
+		{
+			auto it = s.peers.find(key);
+			if (it != s.peers.end() && it->second == p)
+				s.peers.erase(it);
+
+			auto waiters = std::move(p->waiters);
+			p->waiters.clear();
+
+			for (const auto& waiter : waiters)
+				waiter(ec, nullptr);
+		}
+
+		// the next call to the peer opens a new connection
+		void evict(shard& s, const std::string& key, const std::weak_ptr<peer>& weak)
+		{
+			auto p = weak.lock();
+			if (!p || !p->connection)
+				return;
+
+			auto it = s.peers.find(key);
+			if (it != s.peers.end() && it->second == p)
+				s.peers.erase(it);
+		}
+
+		void run(shard& s)
+		{
+			detail::run(s.io_service, options_.busy_poll, *metrics_);
+		}
+
+		void stop()
+		{
+			for (auto& s : shards_)
+				s->io_service.stop();
+
+			for (auto& s : shards_)
+			{
+				if (s->thread.joinable())
+					s->thread.join();
+			}
+		}
+
+		std::shared_ptr<detail::metrics> metrics_ = std::make_shared<detail::metrics>();
+		std::shared_ptr<detail::tracer> tracer_ = std::make_shared<detail::tracer>();
+		std::shared_ptr<detail::capturer> capturer_ = std::make_shared<detail::capturer>();
+		io_options options_;
+		std::vector<std::unique_ptr<shard>> shards_;
+
+		// identifies the context in the shard assignments of threads, unlike its address which may be reused
+		std::uint64_t id_ = next_id();
+		std::size_t slot_ = slots().acquire();
+		std::atomic<std::size_t> next_shard_{0};
+	};
+}
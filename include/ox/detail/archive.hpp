@@ -1,12 +1,19 @@
 #pragma once
+#include "../priority.hpp"
+#include "../view.hpp"
 #include "connection.hpp"
+#include "fixed_layout.hpp"
 #include "util.hpp"
 #include <boost/cast.hpp>
 #include <boost/optional.hpp>
 #include <cereal/cereal.hpp>
 #include <cereal/types/tuple.hpp>
+#include <cstring>
 #include <exception>
+#include <limits>
+#include <memory>
 #include <type_traits>
+#include <vector>
 
 namespace ox
 {
@@ -15,10 +22,14 @@ namespace ox
 		class oarchive : public cereal::OutputArchive<oarchive>
 		{
 		public:
-			oarchive(std::ostream& os, const std::shared_ptr<connection>& connection)
+			// callbacks saved to the archive are invoked by the peer in the lane given here,
+			// and belong to call if it is tracked by the connection
+			oarchive(std::ostream& os, const std::shared_ptr<connection>& connection, priority lane = priority::normal, std::uint64_t call = 0)
 				: cereal::OutputArchive<oarchive>(this)
 				, os_(os)
 				, connection_(connection)
+				, lane_(lane)
+				, call_(call)
 			{
 			}
 
@@ -34,34 +45,80 @@ namespace ox
 				save_binary(reinterpret_cast<const char*>(&value), sizeof(value));
 			}
 
-			void save_string(const std::string& value)
+			void save_string(string_view value)
 			{
 				std::uint64_t size = value.size();
 				save_integer(size);
 				save_binary(value.data(), value.size());
 			}
 
+			// the same as a std::vector of arithmetic values
+			template <class Value>
+			void save_array_view(const array_view<Value>& value)
+			{
+				std::uint64_t size = value.size();
+				save_integer(size);
+				save_binary(reinterpret_cast<const char*>(value.data()), value.size() * sizeof(Value));
+			}
+
 			template <class... Arguments>
 			void save_function(const std::function<void(Arguments...)>& value);
 
+			template <class... Values>
+			void save_arguments(const std::tuple<Values...>& values)
+			{
+				save_arguments(values, is_fixed_layout<Values...>());
+			}
+
 		private:
+			template <class... Values>
+			void save_arguments(const std::tuple<Values...>& values, std::true_type)
+			{
+				std::array<char, packed_size<Values...>()> buffer;
+				pack(buffer.data(), values, std::index_sequence_for<Values...>());
+				save_binary(buffer.data(), buffer.size());
+			}
+
+			template <class... Values>
+			void save_arguments(const std::tuple<Values...>& values, std::false_type)
+			{
+				(*this)(values);
+			}
+
 			std::ostream& os_;
 			std::shared_ptr<connection> connection_;
+			priority lane_;
+			std::uint64_t call_;
 		};
 
 		class iarchive : public cereal::InputArchive<iarchive>
 		{
 		public:
-			iarchive(std::istream& is, const std::shared_ptr<connection>& connection)
+			// views loaded from data refer to it, so it must outlive their use;
+			// callbacks passed to the functions loaded from it belong to call
+			iarchive(string_view data, const std::shared_ptr<connection>& connection, std::uint64_t call = 0)
 				: cereal::InputArchive<iarchive>(this)
-				, is_(is)
+				, position_(data.data())
+				, end_(data.data() + data.size())
 				, connection_(connection)
+				, call_(call)
+			{
+			}
+
+			const char* load_view(std::size_t size)
 			{
+				if (size > static_cast<std::size_t>(end_ - position_))
+					throw cereal::Exception("Failed to read " + std::to_string(size) + " bytes from input buffer");
+
+				auto result = position_;
+				position_ += size;
+
+				return result;
 			}
 
 			void load_binary(char* data, std::size_t size)
 			{
-				is_.read(data, size);
+				std::memcpy(data, load_view(size), size);
 			}
 
 			template <class Value>
@@ -80,62 +137,145 @@ namespace ox
 				load_binary(&value.front(), value.size());
 			}
 
+			void load_string(string_view& value)
+			{
+				std::uint64_t size;
+				load_integer(size);
+
+				auto n = boost::numeric_cast<std::size_t>(size);
+				value = string_view(load_view(n), n);
+			}
+
+			template <class Value>
+			void load_array_view(array_view<const Value>& value)
+			{
+				std::uint64_t size;
+				load_integer(size);
+
+				auto n = boost::numeric_cast<std::size_t>(size);
+				if (n > std::numeric_limits<std::size_t>::max() / sizeof(Value))
+					throw cereal::Exception("Span size is out of range");
+
+				auto data = load_view(n * sizeof(Value));
+
+				// the frame gives no alignment, so misaligned elements are copied aside
+				if (reinterpret_cast<std::uintptr_t>(data) % alignof(Value) != 0)
+				{
+					std::unique_ptr<char[]> copy(new char[n * sizeof(Value)]);
+					std::memcpy(copy.get(), data, n * sizeof(Value));
+
+					data = copy.get();
+					copies_.push_back(std::move(copy));
+				}
+
+				value = array_view<const Value>(reinterpret_cast<const Value*>(data), n);
+			}
+
 			template <class... Arguments>
 			void load_function(std::function<void(Arguments...)>& value);
 
+			// skips a function of any type and lets the peer release it, as if it had been loaded and dropped
+			void release_function();
+
+			template <class... Values>
+			void load_arguments(std::tuple<Values...>& values)
+			{
+				load_arguments(values, is_fixed_layout<Values...>());
+			}
+
 		private:
-			std::istream& is_;
+			template <class... Values>
+			void load_arguments(std::tuple<Values...>& values, std::true_type)
+			{
+				unpack(load_view(packed_size<Values...>()), values, std::index_sequence_for<Values...>());
+			}
+
+			template <class... Values>
+			void load_arguments(std::tuple<Values...>& values, std::false_type)
+			{
+				(*this)(values);
+			}
+
+			const char* position_;
+			const char* end_;
 			std::shared_ptr<connection> connection_;
+			std::uint64_t call_;
+			std::vector<std::unique_ptr<char[]>> copies_;
 		};
 
 		template <class... Arguments>
 		void oarchive::save_function(const std::function<void(Arguments...)>& value)
 		{
 			auto c = connection_;
+			auto call = call_;
 
-			auto id = connection_->resgister_callback([value, c](const auto& str) {
-				std::istringstream is(str);
-				iarchive ia(is, c);
-
-				std::tuple<std::decay_t<Arguments>...> args;
-				ia(args);
-
+			auto id = connection_->resgister_callback([value, c, call](string_view str) {
 				try
 				{
+					// replies to the peer's functions among the arguments keep the call in flight
+					iarchive ia(str, c, call);
+
+					std::tuple<std::decay_t<Arguments>...> args;
+					ia.load_arguments(args);
+
 					apply(value, args);
 				}
 				catch (...)
 				{
 				}
-			});
+			}, call_);
 
 			save_integer(id);
+			save_integer(static_cast<std::uint8_t>(lane_));
 		}
 
 		template <class... Arguments>
 		void iarchive::load_function(std::function<void(Arguments...)>& value)
 		{
 			auto c = connection_;
+			auto call = call_;
 
 			std::uint64_t id;
 			load_integer(id);
 
-			auto deleter = std::shared_ptr<void>(nullptr, [c, id](auto) {
-				c->unregister_callback_remote(id);
+			std::uint8_t value_lane;
+			load_integer(value_lane);
+
+			if (value_lane >= priority_count)
+				throw cereal::Exception("Invalid priority");
+
+			auto lane = static_cast<priority>(value_lane);
+
+			auto deleter = std::shared_ptr<void>(nullptr, [c, id, lane](auto) {
+				c->unregister_callback_remote(id, lane);
 			});
 
-			value = [c, id, deleter](Arguments... args) {
+			value = [c, id, lane, call, deleter](Arguments... args) {
 				std::ostringstream os;
 
 				{
-					oarchive oa(os, c);
-					oa(std::make_tuple(args...));
+					oarchive oa(os, c, lane, call);
+					oa.save_arguments(std::make_tuple(args...));
 				}
 
-				c->invoke_remote(id, os.str());
+				c->invoke_remote(id, os.str(), lane);
 			};
 		}
 
+		inline void iarchive::release_function()
+		{
+			std::uint64_t id;
+			load_integer(id);
+
+			std::uint8_t value_lane;
+			load_integer(value_lane);
+
+			if (value_lane >= priority_count)
+				throw cereal::Exception("Invalid priority");
+
+			connection_->unregister_callback_remote(id, static_cast<priority>(value_lane));
+		}
+
 		template <class Value>
 		typename std::enable_if<std::is_arithmetic<Value>::value>::type
 		CEREAL_SAVE_FUNCTION_NAME(oarchive& ar, const Value& value)
@@ -148,6 +288,17 @@ namespace ox
 			ar.save_string(value);
 		}
 
+		inline void CEREAL_SAVE_FUNCTION_NAME(oarchive& ar, const string_view& value)
+		{
+			ar.save_string(value);
+		}
+
+		template <class Value>
+		void CEREAL_SAVE_FUNCTION_NAME(oarchive& ar, const array_view<Value>& value)
+		{
+			ar.save_array_view(value);
+		}
+
 		template <class Result, class... Arguments>
 		void CEREAL_SAVE_FUNCTION_NAME(oarchive& ar, const std::function<Result(Arguments...)>& value)
 		{
@@ -179,6 +330,17 @@ namespace ox
 			ar.load_string(value);
 		}
 
+		inline void CEREAL_LOAD_FUNCTION_NAME(iarchive& ar, string_view& value)
+		{
+			ar.load_string(value);
+		}
+
+		template <class Value>
+		void CEREAL_LOAD_FUNCTION_NAME(iarchive& ar, array_view<const Value>& value)
+		{
+			ar.load_array_view(value);
+		}
+
 		template <class Result, class... Arguments>
 		void CEREAL_LOAD_FUNCTION_NAME(iarchive& ar, std::function<Result(Arguments...)>& value)
 		{
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace ox
+{
+	namespace detail
+	{
+		// Recycles frame buffers so that steady traffic does not allocate; not synchronized
+		class buffer_pool
+		{
+		public:
+			explicit buffer_pool(std::size_t max_buffers = 64, std::size_t max_capacity = 64 * 1024)
+				: max_buffers_(max_buffers)
+				, max_capacity_(max_capacity)
+			{
+			}
+
+			std::vector<char> acquire()
+			{
+				if (free_.empty())
+					return std::vector<char>();
+
+				auto result = std::move(free_.back());
+				free_.pop_back();
+
+				return result;
+			}
+
+			// buffers above the capacity limit are freed to bound the memory held by the pool
+			void release(std::vector<char>&& buffer)
+			{
+				if (free_.size() >= max_buffers_ || buffer.capacity() > max_capacity_)
+					return;
+
+				buffer.clear();
+				free_.push_back(std::move(buffer));
+			}
+
+		private:
+			std::size_t max_buffers_;
+			std::size_t max_capacity_;
+			std::vector<std::vector<char>> free_;
+		};
+	}
+}
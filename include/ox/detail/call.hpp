@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace ox
+{
+	namespace detail
+	{
+		// Precedes the receiver of an initial call. The host rejects the call through error,
+		// with an ox::errc value, unless it serves the service with the same function type.
+		struct call_prologue
+		{
+			std::uint64_t fingerprint = 0;
+			std::function<void(int)> error;
+
+			template <class Archive>
+			void serialize(Archive& ar)
+			{
+				ar(fingerprint, error);
+			}
+		};
+
+		// where the callback id of the receiver is found in the payload of an initial call:
+		// after the fingerprint and the error callback, each callback being an id and a lane
+		const std::size_t call_receiver_offset = sizeof(std::uint64_t) + sizeof(std::uint64_t) + sizeof(std::uint8_t);
+	}
+}
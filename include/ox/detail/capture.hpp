@@ -0,0 +1,61 @@
+#pragma once
+#include "../capture.hpp"
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+namespace ox
+{
+	namespace detail
+	{
+		// Passes the frames of a host's or client context's connections to a capture_sink
+		class capturer
+		{
+		public:
+			capturer() = default;
+			capturer(const capturer&) = delete;
+			capturer& operator=(const capturer&) = delete;
+
+			bool enabled() const
+			{
+				return enabled_.load(std::memory_order_relaxed);
+			}
+
+			void set_sink(const std::shared_ptr<capture_sink>& sink)
+			{
+				std::atomic_store(&sink_, sink);
+				enabled_.store(static_cast<bool>(sink), std::memory_order_relaxed);
+			}
+
+			std::uint64_t next_connection()
+			{
+				return connections_.fetch_add(1, std::memory_order_relaxed);
+			}
+
+			void record(std::uint64_t connection, bool received, std::uint64_t id, std::uint64_t size, string_view payload)
+			{
+				if (!enabled())
+					return;
+
+				auto sink = std::atomic_load(&sink_);
+				if (!sink)
+					return;
+
+				captured_frame frame;
+				frame.time = std::chrono::steady_clock::now().time_since_epoch();
+				frame.connection = connection;
+				frame.received = received;
+				frame.id = id;
+				frame.size = size;
+				frame.payload = payload;
+
+				sink->record(frame);
+			}
+
+		private:
+			std::atomic<bool> enabled_{false};
+			std::shared_ptr<capture_sink> sink_;
+			std::atomic<std::uint64_t> connections_{0};
+		};
+	}
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include <boost/version.hpp>
+
+// OX_IO_URING (make io_uring=1) runs all sockets through asio's io_uring backend instead of
+// epoll. The build defines it together with BOOST_ASIO_HAS_IO_URING and BOOST_ASIO_DISABLE_EPOLL
+// for every translation unit, since asio has to be configured the same way wherever it is included.
+#if defined(OX_IO_URING) && BOOST_VERSION < 107800
+#error "OX_IO_URING requires Boost 1.78 or later"
+#endif
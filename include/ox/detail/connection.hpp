@@ -1,8 +1,29 @@
 #pragma once
+#include "config.hpp"
+#include "../error.hpp"
+#include "../io_options.hpp"
+#include "../priority.hpp"
+#include "../service.hpp"
+#include "../view.hpp"
+#include "buffer_pool.hpp"
+#include "capture.hpp"
+#include "frame.hpp"
+#include "limiter.hpp"
+#include "metrics.hpp"
+#include "service_table.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <boost/asio.hpp>
+#include <boost/noncopyable.hpp>
+#include <chrono>
+#include <deque>
 #include <functional>
+#include <limits>
 #include <memory>
 #include <mutex>
+#include <new>
 #include <unordered_map>
 #include <vector>
 
@@ -17,18 +38,101 @@ namespace ox
 		public:
 			explicit connection(
 				boost::asio::io_service& io_service,
-				const std::function<void(const boost::system::error_code&)>& error_handler)
-				: socket_(io_service)
-				, strand_(io_service)
+				const std::function<void(const boost::system::error_code&)>& error_handler,
+				const std::shared_ptr<detail::metrics>& metrics,
+				const std::shared_ptr<detail::tracer>& tracer)
+				: io_service_(io_service)
+				, socket_(io_service)
 				, error_handler_(error_handler)
+				, metrics_(metrics)
+				, tracer_(tracer)
+				, resume_timer_(io_service)
 			{
 			}
 
+			~connection()
+			{
+				count(metrics::callbacks_released, callback_map_.size());
+				metrics_->adjust(metrics::live_callbacks, -static_cast<std::int64_t>(callback_map_.size()));
+
+				// frames which never completed
+				auto queued = writing_frames_.size();
+				for (const auto& queue : write_queues_)
+					queued += queue.size();
+
+				metrics_->adjust(metrics::write_queue_depth, -static_cast<std::int64_t>(queued));
+
+				if (established_)
+					count(metrics::connections_closed);
+
+				if (limiter_)
+				{
+					limiter_->release(in_flight_);
+
+					if (admitted_)
+						limiter_->close();
+				}
+			}
+
 			boost::asio::ip::tcp::socket& socket()
 			{
 				return socket_;
 			}
 
+			// applies the socket options once the socket is connected; SO_BUSY_POLL is best effort
+			void configure(const io_options& options)
+			{
+				boost::system::error_code ec;
+
+				socket_.set_option(boost::asio::ip::tcp::no_delay(options.no_delay), ec);
+
+#if defined(SO_BUSY_POLL)
+				if (options.socket_busy_poll > 0)
+					socket_.set_option(boost::asio::detail::socket_option::integer<SOL_SOCKET, SO_BUSY_POLL>(options.socket_busy_poll), ec);
+#endif
+			}
+
+			// records the frames sent and received from now on
+			void capture(const std::shared_ptr<capturer>& capturer)
+			{
+				capture_id_ = capturer->next_connection();
+				capturer_ = capturer;
+			}
+
+			// the limits of a host, shared by its connections
+			void limit(const std::shared_ptr<limiter>& limiter)
+			{
+				limiter_ = limiter;
+			}
+
+			// false if a new call should be rejected with errc::overloaded
+			bool accept_call()
+			{
+				if (!limiter_)
+					return true;
+
+				const auto& limits = limiter_->limits();
+
+				bool overloaded = over_memory_limit();
+
+				if (!overloaded && limits.max_callbacks != 0)
+				{
+					std::lock_guard<std::mutex> lock(mutex_);
+					overloaded = callback_map_.size() >= limits.max_callbacks;
+				}
+
+				if (overloaded)
+					count(metrics::calls_rejected);
+
+				return !overloaded;
+			}
+
+			// frames addressed to reserved ids are dispatched to the entry points of the table
+			void serve(const std::shared_ptr<service_table>& services)
+			{
+				services_ = services;
+			}
+
 			template <class Callback>
 			void handshake_server(Callback callback)
 			{
@@ -37,11 +141,27 @@ namespace ox
 				receive_signature([self, callback](const auto& ec) {
 					if (ec)
 					{
+						self->handshake_completed(ec);
 						callback(ec);
 						return;
 					}
 
-					self->send_signature([self, callback](const auto& ec) {
+					// over the connection limit, the client is told so before the connection is dropped
+					if (self->limiter_ && !self->limiter_->try_open())
+					{
+						self->count(metrics::connections_rejected);
+
+						self->send_signature(get_overloaded_signature(), [callback](const auto& /*ec*/) {
+							callback(make_error_code(errc::overloaded));
+						});
+
+						return;
+					}
+
+					self->admitted_ = true;
+
+					self->send_signature(get_signature(), [self, callback](const auto& ec) {
+						self->handshake_completed(ec);
 						callback(ec);
 					});
 				});
@@ -52,144 +172,407 @@ namespace ox
 			{
 				auto self = this->shared_from_this();
 
-				send_signature([self, callback](const auto& ec) {
+				send_signature(get_signature(), [self, callback](const auto& ec) {
 					if (ec)
 					{
+						self->handshake_completed(ec);
 						callback(ec);
 						return;
 					}
 
 					self->receive_signature([self, callback](const auto& ec) {
+						self->handshake_completed(ec);
 						callback(ec);
 					});
 				});
 			}
 
+			// reads and dispatches frames until an error, which is passed to callback;
+			// the connection is closed then and its callbacks are released
 			template <class Callback>
 			void receive(Callback callback)
 			{
 				auto self = this->shared_from_this();
 
-				receive_integer([self, callback](const auto& ec, std::uint64_t id) {
-					if (ec)
-					{
-						callback(ec);
-						return;
-					}
-
-					self->receive_integer([self, id, callback](const auto& ec, std::uint64_t size) {
-						if (ec)
-						{
-							callback(ec);
-							return;
-						}
+				read_buffer_.resize(read_buffer_size);
+				read([self, callback](const boost::system::error_code& ec) {
+					self->close(ec);
+					callback(ec);
+				});
+			}
 
-						if (size == std::numeric_limits<std::uint64_t>::max())
-						{
-							std::lock_guard<std::mutex> lock(self->mutex_);
+			// a call is in flight until the peer releases the callbacks registered for it, including
+			// those passed in replies to the functions which the peer hands to its callbacks;
+			// its error handler is called once, if sending it fails or the connection fails before
+			std::uint64_t track_call(const std::function<void(const boost::system::error_code&)>& error_handler)
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
 
-							self->callback_map_.erase(id);
-							self->receive(callback);
-						}
-						else
-						{
-							self->strand_.post([self, id, size, callback]() {
-								auto str_buffer = std::make_shared<std::vector<char>>(size);
+				auto call = call_index_++;
+				calls_[call].error_handler = error_handler;
 
-								boost::asio::async_read(self->socket_, boost::asio::buffer(*str_buffer), [self, id, str_buffer, callback](const auto& ec, auto /*bytes_transferred*/) {
-									if (ec)
-									{
-										callback(ec);
-										return;
-									}
+				return call;
+			}
 
-									std::function<void(const std::string&)> f;
+			void fail_call(std::uint64_t call, const boost::system::error_code& ec)
+			{
+				std::function<void(const boost::system::error_code&)> error_handler;
 
-									{
-										std::lock_guard<std::mutex> lock(self->mutex_);
+				{
+					std::lock_guard<std::mutex> lock(mutex_);
 
-										auto it = self->callback_map_.find(id);
-										if (it != self->callback_map_.end())
-											f = it->second;
-									}
+					auto it = calls_.find(call);
+					if (it == calls_.end())
+						return;
 
-									if (f)
-										f(std::string(str_buffer->data(), str_buffer->size()));
+					error_handler = std::move(it->second.error_handler);
+					calls_.erase(it);
+				}
 
-									self->receive(callback);
-								});
-							});
-						}
-					});
-				});
+				error_handler(ec);
 			}
 
-			std::uint64_t resgister_callback(const std::function<void(const std::string&)>& callback)
+			// call is the tracked call which the callback belongs to, or 0
+			std::uint64_t resgister_callback(const std::function<void(string_view)>& callback, std::uint64_t call = 0)
 			{
 				std::lock_guard<std::mutex> lock(mutex_);
 
 				auto index = index_++;
 				callback_map_.insert(std::make_pair(index, callback));
 
+				auto it = calls_.find(call);
+				if (it != calls_.end())
+				{
+					++it->second.callbacks;
+					callback_calls_[index] = call;
+				}
+
+				count(metrics::callbacks_registered);
+				metrics_->adjust(metrics::live_callbacks, 1);
+
 				return index;
 			}
 
-			void unregister_callback_remote(std::uint64_t id)
+			// takes the lane of the callback's invocations so that it cannot overtake them
+			void unregister_callback_remote(std::uint64_t id, priority lane = priority::normal)
 			{
-				auto self = this->shared_from_this();
+				outgoing frame;
+				frame.buffer = acquire_buffer();
+				frame.lane = lane;
+				frame.error_handler = error_handler_;
 
-				auto buffer = std::make_shared<std::vector<char>>();
+				frame.buffer.resize(max_header_size);
+				frame.buffer.resize(encode_header(frame.buffer.data(), trace_context(), id, std::numeric_limits<std::uint64_t>::max()) - frame.buffer.data());
 
-				write_integer(*buffer, id);
-				write_integer(*buffer, std::numeric_limits<std::uint64_t>::max());
+				if (capturer_)
+					capturer_->record(capture_id_, false, id, std::numeric_limits<std::uint64_t>::max(), string_view());
 
-				strand_.post([self, buffer]() {
-					boost::asio::async_write(self->socket_, boost::asio::buffer(*buffer), [self, buffer](const auto& ec, auto /*bytes_transferred*/) {
-						if (ec)
-						{
-							self->error_handler_(ec);
-							return;
-						}
-					});
-				});
+				write(std::move(frame));
 			}
 
-			void invoke_remote(std::uint64_t id, const std::string& str)
+			void invoke_remote(std::uint64_t id, const std::string& str, priority lane = priority::normal)
 			{
-				auto self = this->shared_from_this();
+				invoke_remote(id, str, error_handler_, lane);
+			}
 
-				auto buffer = std::make_shared<std::vector<char>>();
+			// frames carry the context of the span running on the calling thread, if any;
+			// a failure to send this frame is reported to error_handler instead of the connection's handler
+			void invoke_remote(std::uint64_t id, const std::string& str, const std::function<void(const boost::system::error_code&)>& error_handler, priority lane = priority::normal)
+			{
+				outgoing frame;
+				frame.buffer = acquire_buffer();
+				frame.lane = lane;
+				frame.error_handler = error_handler;
 
-				write_integer(*buffer, id);
-				write_integer(*buffer, str.size());
+				// forwarded even when this side does not trace, so that a nested call keeps its parent
+				frame.context = tracer::current();
 
-				buffer->insert(buffer->end(), str.begin(), str.end());
+				// the header is encoded in place, and the payload is appended behind it
+				frame.buffer.reserve(max_header_size + str.size());
+				frame.buffer.resize(max_header_size);
 
-				strand_.post([self, buffer]() {
-					boost::asio::async_write(self->socket_, boost::asio::buffer(*buffer), [self, buffer](const auto& ec, auto /*bytes_transferred*/) {
-						if (ec)
+				auto end = encode_header(frame.buffer.data(), frame.context, id, str.size());
+				frame.buffer.resize(end - frame.buffer.data());
+
+				frame.buffer.insert(frame.buffer.end(), str.begin(), str.end());
+
+				if (capturer_)
+					capturer_->record(capture_id_, false, id, str.size(), str);
+
+				write(std::move(frame));
+			}
+
+		private:
+			static const std::size_t read_buffer_size = 64 * 1024;
+
+			struct outgoing
+			{
+				std::vector<char> buffer;
+				priority lane = priority::normal;
+
+				// stream of a fragmented frame and the part of it written so far
+				std::uint64_t stream = 0;
+				std::size_t offset = 0;
+
+				trace_context context;
+				active_span span;
+				std::function<void(const boost::system::error_code&)> error_handler;
+			};
+
+			struct pending_call
+			{
+				std::function<void(const boost::system::error_code&)> error_handler;
+				std::size_t callbacks = 0;
+			};
+
+			// callbacks hold the connection, so they are dropped to let it go;
+			// the calls still in flight fail with ec
+			void close(const boost::system::error_code& ec)
+			{
+				boost::system::error_code ignored;
+				socket_.close(ignored);
+
+				std::unordered_map<std::uint64_t, std::function<void(string_view)>> callbacks;
+				std::unordered_map<std::uint64_t, pending_call> calls;
+
+				{
+					std::lock_guard<std::mutex> lock(mutex_);
+					callbacks.swap(callback_map_);
+					calls.swap(calls_);
+					callback_calls_.clear();
+				}
+
+				count(metrics::callbacks_released, callbacks.size());
+				metrics_->adjust(metrics::live_callbacks, -static_cast<std::int64_t>(callbacks.size()));
+
+				for (auto& call : calls)
+					call.second.error_handler(ec);
+			}
+
+			void count(metrics::counter c, std::uint64_t value = 1)
+			{
+				if (metrics_->enabled())
+					metrics_->add(c, value);
+			}
+
+			// in-flight bytes are counted against the connection's and the host's limits
+			void hold(std::size_t bytes)
+			{
+				if (!limiter_)
+					return;
+
+				in_flight_ += bytes;
+				limiter_->acquire(bytes);
+			}
+
+			// for frames being received, which must not take the memory of the host past its budget
+			bool try_hold(std::size_t bytes)
+			{
+				if (!limiter_)
+					return true;
+
+				if (!limiter_->try_acquire(bytes))
+					return false;
+
+				in_flight_ += bytes;
+
+				return true;
+			}
+
+			void unhold(std::size_t bytes)
+			{
+				if (!limiter_)
+					return;
+
+				in_flight_ -= bytes;
+				limiter_->release(bytes);
+
+				if (paused_ && !over_memory_limit())
+					resume();
+			}
+
+			bool fits_in_flight(std::uint64_t bytes) const
+			{
+				return !limiter_ || limiter_->limits().max_in_flight_bytes == 0 || bytes <= limiter_->limits().max_in_flight_bytes;
+			}
+
+			bool over_memory_limit() const
+			{
+				if (!limiter_)
+					return false;
+
+				auto max = limiter_->limits().max_in_flight_bytes;
+
+				return (max != 0 && in_flight_ >= max) || limiter_->exhausted();
+			}
+
+			void handshake_completed(const boost::system::error_code& ec)
+			{
+				if (ec)
+				{
+					count(metrics::handshake_failures);
+					return;
+				}
+
+				established_ = true;
+				count(metrics::connections_opened);
+			}
+
+			std::vector<char> acquire_buffer()
+			{
+				std::lock_guard<std::mutex> lock(write_mutex_);
+				return buffer_pool_.acquire();
+			}
+
+			// frames are queued per lane and sent in batches with one gathered write each
+			void write(outgoing&& frame)
+			{
+				count(metrics::writes_queued);
+				metrics_->adjust(metrics::write_queue_depth, 1);
+				hold(frame.buffer.size());
+
+				if (frame.context)
+					frame.span = tracer_->start("queue", frame.context);
+
+				bool start;
+
+				{
+					std::lock_guard<std::mutex> lock(write_mutex_);
+
+					write_queues_[lane_index(frame.lane)].push_back(std::move(frame));
+
+					start = !writing_;
+					writing_ = true;
+				}
+
+				if (start)
+				{
+					auto self = this->shared_from_this();
+
+					io_service_.post([self]() {
+						self->write_queued();
+					});
+				}
+			}
+
+			// a batch takes the lanes in order, and from each lane the frames up to and
+			// including the first fragment, so a bulk frame delays others by one fragment
+			void write_queued()
+			{
+				write_buffers_.clear();
+
+				{
+					std::lock_guard<std::mutex> lock(write_mutex_);
+
+					for (std::size_t lane = 0; lane < priority_count; ++lane)
+					{
+						auto& queue = write_queues_[lane];
+
+						while (!queue.empty())
 						{
-							self->error_handler_(ec);
-							return;
+							auto& frame = queue.front();
+
+							if (frame.offset == 0)
+							{
+								// finished once the lock is released, since a sink may block
+								if (frame.span)
+									finished_spans_.push_back(frame.span);
+
+								if (frame.context)
+									frame.span = tracer_->start("write", frame.context);
+							}
+
+							if (frame.offset == 0 && frame.buffer.size() <= fragment_size)
+							{
+								write_buffers_.push_back(boost::asio::buffer(frame.buffer));
+								writing_frames_.push_back(std::move(frame));
+								queue.pop_front();
+								continue;
+							}
+
+							if (frame.offset == 0)
+								frame.stream = stream_++;
+
+							auto size = frame.buffer.size() - frame.offset;
+							if (size > fragment_size)
+								size = fragment_size;
+
+							auto& header = fragment_headers_[lane];
+							header.resize(max_header_size);
+							header.resize(encode_fragment_header(header.data(), frame.stream, size) - header.data());
+
+							write_buffers_.push_back(boost::asio::buffer(header));
+							write_buffers_.push_back(boost::asio::buffer(frame.buffer.data() + frame.offset, size));
+
+							frame.offset += size;
+
+							// the data stays in place when the buffer is moved
+							if (frame.offset == frame.buffer.size())
+							{
+								writing_frames_.push_back(std::move(frame));
+								queue.pop_front();
+							}
+
+							break;
 						}
-					});
+					}
+
+					if (write_buffers_.empty())
+					{
+						writing_ = false;
+						return;
+					}
+				}
+
+				for (const auto& span : finished_spans_)
+					tracer_->finish(span);
+
+				finished_spans_.clear();
+
+				auto self = this->shared_from_this();
+
+				boost::asio::async_write(socket_, write_buffers_, [self](const auto& ec, auto /*bytes_transferred*/) {
+					self->write_completed(ec);
 				});
 			}
 
-		private:
-			static const std::size_t signature_size = 3;
-
-			constexpr static std::array<char, signature_size> get_signature()
+			void write_completed(const boost::system::error_code& ec)
 			{
-				return {{0x6f, 0x78, 0x00}};
+				for (auto& frame : writing_frames_)
+				{
+					tracer_->finish(frame.span);
+					count(metrics::writes_completed);
+					metrics_->adjust(metrics::write_queue_depth, -1);
+					unhold(frame.buffer.size());
+
+					if (ec)
+					{
+						frame.error_handler(ec);
+					}
+					else if (metrics_->enabled())
+					{
+						metrics_->add(metrics::frames_sent);
+						metrics_->add(metrics::bytes_sent, frame.buffer.size());
+					}
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(write_mutex_);
+
+					for (auto& frame : writing_frames_)
+						buffer_pool_.release(std::move(frame.buffer));
+				}
+
+				writing_frames_.clear();
+				write_queued();
 			}
 
 			template <class Callback>
-			void send_signature(Callback callback)
+			void send_signature(const std::array<char, signature_size>& signature, Callback callback)
 			{
 				auto self = this->shared_from_this();
 
-				boost::asio::async_write(socket_, boost::asio::buffer(get_signature()), [self, callback](const auto& ec, auto /*bytes_transferred*/) {
+				boost::asio::async_write(socket_, boost::asio::buffer(signature), [self, callback](const auto& ec, auto /*bytes_transferred*/) {
 					callback(ec);
 				});
 			}
@@ -207,6 +590,12 @@ namespace ox
 						return;
 					}
 
+					if (*signature == get_overloaded_signature())
+					{
+						callback(make_error_code(errc::overloaded));
+						return;
+					}
+
 					if (*signature != get_signature())
 					{
 						callback(boost::system::errc::make_error_code(boost::system::errc::bad_message));
@@ -217,147 +606,408 @@ namespace ox
 				});
 			}
 
-			void write_integer(std::vector<char>& buffer, std::uint64_t value)
+			template <class Callback>
+			void read(Callback callback)
 			{
-				auto self = this->shared_from_this();
-
-				if (value < 0x80)
+				// keep the unparsed part and make room behind it
+				if (read_begin_ != 0)
 				{
-					buffer.push_back(static_cast<char>(value));
+					std::copy(read_buffer_.begin() + read_begin_, read_buffer_.begin() + read_end_, read_buffer_.begin());
+					read_end_ -= read_begin_;
+					read_begin_ = 0;
 				}
-				else if (value < 0x100)
-				{
-					buffer.push_back(static_cast<char>(0xcc));
-					buffer.push_back(static_cast<char>(value));
-				}
-				else if (value < 0x10000)
-				{
-					buffer.push_back(static_cast<char>(0xcd));
-					buffer.push_back(static_cast<char>((value >> 8) & 0xff));
-					buffer.push_back(static_cast<char>(value & 0xff));
-				}
-				else if (value < 0x100000000)
+
+				auto self = this->shared_from_this();
+
+				// reading goes on while a frame is being reassembled, since only its end frees its memory;
+				// reassembly is bounded by the in-flight limit and the budget, and no new frame is taken over the budget
+				if (fragments_.empty() && over_memory_limit())
 				{
-					buffer.push_back(static_cast<char>(0xce));
-					buffer.push_back(static_cast<char>((value >> 24) & 0xff));
-					buffer.push_back(static_cast<char>((value >> 16) & 0xff));
-					buffer.push_back(static_cast<char>((value >> 8) & 0xff));
-					buffer.push_back(static_cast<char>(value & 0xff));
+					count(metrics::reads_paused);
+
+					// the wait never expires; resume() cancels it, and read() checks the limits again
+					paused_ = true;
+					resume_timer_.expires_at(boost::asio::steady_timer::time_point::max());
+					resume_timer_.async_wait([self, callback](const auto& /*ec*/) {
+						self->read(callback);
+					});
+
+					wait_for_memory();
+					return;
 				}
-				else
+
+				socket_.async_read_some(boost::asio::buffer(read_buffer_.data() + read_end_, read_buffer_.size() - read_end_), [self, callback](const auto& ec, std::size_t bytes_transferred) {
+					if (ec)
+					{
+						callback(ec);
+						return;
+					}
+
+					self->read_end_ += bytes_transferred;
+					self->count(metrics::bytes_received, bytes_transferred);
+
+					self->process(callback);
+				});
+			}
+
+			// the paused read is resumed by this connection freeing memory, or by any connection
+			// of the host if the budget is exhausted
+			void wait_for_memory()
+			{
+				if (limiter_->exhausted())
 				{
-					buffer.push_back(static_cast<char>(0xcf));
-					buffer.push_back(static_cast<char>((value >> 56) & 0xff));
-					buffer.push_back(static_cast<char>((value >> 48) & 0xff));
-					buffer.push_back(static_cast<char>((value >> 40) & 0xff));
-					buffer.push_back(static_cast<char>((value >> 32) & 0xff));
-					buffer.push_back(static_cast<char>((value >> 24) & 0xff));
-					buffer.push_back(static_cast<char>((value >> 16) & 0xff));
-					buffer.push_back(static_cast<char>((value >> 8) & 0xff));
-					buffer.push_back(static_cast<char>(value & 0xff));
+					std::weak_ptr<connection> weak = this->shared_from_this();
+
+					limiter_->wait([weak]() {
+						if (auto self = weak.lock())
+							self->resume();
+					});
 				}
+
+				// memory freed before the connection was paused did not resume it
+				if (!over_memory_limit())
+					resume();
 			}
 
-			template <class Callback>
-			void receive_integer(Callback callback)
+			// called on any thread
+			void resume()
 			{
+				if (!paused_.exchange(false))
+					return;
+
 				auto self = this->shared_from_this();
 
-				strand_.post([self, callback]() {
-					auto buffer = std::make_shared<std::vector<char>>(8);
+				io_service_.post([self]() {
+					boost::system::error_code ec;
+					self->resume_timer_.cancel(ec);
+				});
+			}
 
-					boost::asio::async_read(self->socket_, boost::asio::buffer(buffer->data(), 1), [self, buffer, callback](const auto& ec, auto /*bytes_transferred*/) {
-						if (ec)
+			// dispatches every complete frame in the read buffer, then reads more
+			template <class Callback>
+			void process(Callback callback)
+			{
+				for (;;)
+				{
+					if (read_begin_ != read_end_ && static_cast<std::uint8_t>(read_buffer_[read_begin_]) == fragment_marker)
+					{
+						fragment_header fragment;
+
+						switch (parse_fragment_header(read_buffer_.data() + read_begin_, read_buffer_.data() + read_end_, fragment))
 						{
-							callback(ec, 0);
+						case parse_result::incomplete:
+							read(callback);
 							return;
+						case parse_result::invalid:
+							callback(boost::system::errc::make_error_code(boost::system::errc::bad_message));
+							return;
+						case parse_result::complete:
+							break;
 						}
 
-						auto type = static_cast<std::uint8_t>((*buffer)[0]);
-
-						if (type < 0x80)
+						if (fragment.size > read_end_ - read_begin_ - fragment.length)
 						{
-							callback(ec, type);
+							read(callback);
+							return;
 						}
-						else
+
+						read_begin_ += fragment.length;
+
+						auto ec = reassemble(fragment.stream, string_view(read_buffer_.data() + read_begin_, static_cast<std::size_t>(fragment.size)));
+						if (ec)
 						{
-							self->strand_.post([self, buffer, type, callback]() {
-								std::size_t size;
-
-								switch (type)
-								{
-								case 0xcc:
-									size = 1;
-									break;
-								case 0xcd:
-									size = 2;
-									break;
-								case 0xce:
-									size = 4;
-									break;
-								case 0xcf:
-									size = 8;
-									break;
-								default:
-									callback(boost::system::errc::make_error_code(boost::system::errc::bad_message), 0);
-									return;
-								}
-
-								boost::asio::async_read(self->socket_, boost::asio::buffer(buffer->data(), size), [self, buffer, size, callback](const auto& ec, auto /*bytes_transferred*/) {
-									if (ec)
-									{
-										callback(ec, 0);
-										return;
-									}
-
-									std::uint64_t value;
-									auto p = buffer->data();
-
-									switch (size)
-									{
-									case 1:
-										value = static_cast<std::uint64_t>(p[0]);
-										break;
-									case 2:
-										value = static_cast<std::uint64_t>(p[0]) << 8;
-										value |= static_cast<std::uint64_t>(p[1]);
-										break;
-									case 4:
-										value = static_cast<std::uint64_t>(p[0]) << 24;
-										value |= static_cast<std::uint64_t>(p[1]) << 16;
-										value |= static_cast<std::uint64_t>(p[2]) << 8;
-										value |= static_cast<std::uint64_t>(p[3]);
-										break;
-									case 8:
-										value = static_cast<std::uint64_t>(p[0]) << 56;
-										value |= static_cast<std::uint64_t>(p[1]) << 48;
-										value |= static_cast<std::uint64_t>(p[2]) << 40;
-										value |= static_cast<std::uint64_t>(p[3]) << 32;
-										value |= static_cast<std::uint64_t>(p[4]) << 24;
-										value |= static_cast<std::uint64_t>(p[5]) << 16;
-										value |= static_cast<std::uint64_t>(p[6]) << 8;
-										value |= static_cast<std::uint64_t>(p[7]);
-										break;
-									default:
-										callback(boost::system::errc::make_error_code(boost::system::errc::bad_message), 0);
-										return;
-									}
-
-									callback(ec, value);
-								});
-							});
+							callback(ec);
+							return;
 						}
-					});
+
+						read_begin_ += static_cast<std::size_t>(fragment.size);
+						continue;
+					}
+
+					frame_header header;
+
+					switch (parse_header(read_buffer_.data() + read_begin_, read_buffer_.data() + read_end_, header))
+					{
+					case parse_result::incomplete:
+						read(callback);
+						return;
+					case parse_result::invalid:
+						callback(boost::system::errc::make_error_code(boost::system::errc::bad_message));
+						return;
+					case parse_result::complete:
+						break;
+					}
+
+					auto available = read_end_ - read_begin_ - header.length;
+
+					// unregister frames have no payload
+					if (header.size == std::numeric_limits<std::uint64_t>::max() || header.size <= available)
+					{
+						auto size = header.size <= available ? static_cast<std::size_t>(header.size) : 0;
+
+						read_begin_ += header.length;
+						received(header, string_view(read_buffer_.data() + read_begin_, size));
+						read_begin_ += size;
+						continue;
+					}
+
+					// the header fits into the buffer, so the subtraction cannot wrap
+					if (header.size <= read_buffer_.size() - header.length)
+					{
+						read(callback);
+						return;
+					}
+
+					read_large(header, callback);
+					return;
+				}
+			}
+
+			// a frame which does not fit into the read buffer is read into its own
+			template <class Callback>
+			void read_large(const frame_header& header, Callback callback)
+			{
+				auto error = boost::system::errc::make_error_code(boost::system::errc::message_size);
+
+				if (header.size > std::vector<char>().max_size() || !fits_in_flight(header.size))
+				{
+					callback(error);
+					return;
+				}
+
+				// the memory is accounted before it is allocated
+				auto size = static_cast<std::size_t>(header.size);
+
+				if (!try_hold(size))
+				{
+					callback(make_error_code(errc::overloaded));
+					return;
+				}
+
+				std::shared_ptr<std::vector<char>> payload;
+
+				try
+				{
+					payload = std::make_shared<std::vector<char>>(size);
+				}
+				catch (const std::bad_alloc&)
+				{
+					unhold(size);
+					callback(error);
+					return;
+				}
+
+				auto begin = read_buffer_.begin() + read_begin_ + header.length;
+				auto available = static_cast<std::size_t>(read_end_ - read_begin_ - header.length);
+				std::copy(begin, begin + available, payload->begin());
+
+				read_begin_ = 0;
+				read_end_ = 0;
+
+				auto self = this->shared_from_this();
+
+				boost::asio::async_read(socket_, boost::asio::buffer(payload->data() + available, payload->size() - available), [self, header, payload, callback](const auto& ec, std::size_t bytes_transferred) {
+					if (ec)
+					{
+						callback(ec);
+						return;
+					}
+
+					self->count(metrics::bytes_received, bytes_transferred);
+
+					self->received(header, string_view(payload->data(), payload->size()));
+					self->unhold(payload->size());
+
+					self->process(callback);
 				});
 			}
 
+			// appends a fragment to its stream and dispatches the frame once it is complete;
+			// fails if the stream does not form a valid frame or the limits would be exceeded
+			boost::system::error_code reassemble(std::uint64_t stream, string_view data)
+			{
+				auto it = fragments_.find(stream);
+
+				if (it == fragments_.end())
+				{
+					// a sender fragments at most one frame per lane at a time
+					if (fragments_.size() >= priority_count)
+						return boost::system::errc::make_error_code(boost::system::errc::bad_message);
+
+					it = fragments_.emplace(stream, std::vector<char>()).first;
+				}
+
+				// all frames being reassembled count against the in-flight limit together
+				if (!fits_in_flight(reassembling_ + data.size()))
+					return boost::system::errc::make_error_code(boost::system::errc::message_size);
+
+				if (!try_hold(data.size()))
+					return make_error_code(errc::overloaded);
+
+				auto& buffer = it->second;
+				buffer.insert(buffer.end(), data.begin(), data.end());
+				reassembling_ += data.size();
+
+				auto invalid = boost::system::errc::make_error_code(boost::system::errc::bad_message);
+
+				frame_header header;
+
+				switch (parse_header(buffer.data(), buffer.data() + buffer.size(), header))
+				{
+				case parse_result::incomplete:
+					return boost::system::error_code();
+				case parse_result::invalid:
+					return invalid;
+				case parse_result::complete:
+					break;
+				}
+
+				auto size = buffer.size() - header.length;
+
+				if (header.size > size)
+					return boost::system::error_code();
+
+				if (header.size < size)
+					return invalid;
+
+				auto frame = std::move(buffer);
+				fragments_.erase(it);
+				reassembling_ -= frame.size();
+
+				received(header, string_view(frame.data() + header.length, size));
+				unhold(frame.size());
+
+				return boost::system::error_code();
+			}
+
+			void received(const frame_header& header, string_view payload)
+			{
+				count(metrics::frames_received);
+
+				if (header.size != std::numeric_limits<std::uint64_t>::max())
+				{
+					dispatch(header, payload);
+					return;
+				}
+
+				if (capturer_)
+					capturer_->record(capture_id_, true, header.id, header.size, string_view());
+
+				release_callback(header.id);
+			}
+
+			void release_callback(std::uint64_t id)
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+
+				if (callback_map_.erase(id) != 0)
+				{
+					count(metrics::callbacks_released);
+					metrics_->adjust(metrics::live_callbacks, -1);
+				}
+
+				auto it = callback_calls_.find(id);
+				if (it == callback_calls_.end())
+					return;
+
+				// the call is complete once all of its callbacks are released
+				auto call = calls_.find(it->second);
+				if (call != calls_.end() && --call->second.callbacks == 0)
+					calls_.erase(call);
+
+				callback_calls_.erase(it);
+			}
+
+			void dispatch(const frame_header& header, string_view str)
+			{
+				if (capturer_)
+					capturer_->record(capture_id_, true, header.id, header.size, str);
+
+				std::function<void(string_view)> f;
+
+				if (services_ && service_id::is_reserved(header.id))
+				{
+					if (auto entry = services_->find(header.id))
+					{
+						auto self = this->shared_from_this();
+
+						f = [self, entry](string_view str) {
+							entry(self, str);
+						};
+					}
+				}
+				else
+				{
+					std::lock_guard<std::mutex> lock(mutex_);
+
+					auto it = callback_map_.find(header.id);
+					if (it != callback_map_.end())
+						f = it->second;
+				}
+
+				if (f)
+					dispatch(f, str, header.context);
+			}
+
+			void dispatch(const std::function<void(string_view)>& f, string_view str, const trace_context& context)
+			{
+				// an untraced hop passes the context of the frame on to the calls it makes
+				auto span = tracer_->start("dispatch", context);
+				trace_scope scope(span ? span.context : context);
+
+				if (metrics_->enabled())
+				{
+					auto start = std::chrono::steady_clock::now();
+					f(str);
+					metrics_->record_dispatch(std::chrono::steady_clock::now() - start);
+				}
+				else
+				{
+					f(str);
+				}
+
+				tracer_->finish(span);
+			}
+
+			boost::asio::io_service& io_service_;
 			boost::asio::ip::tcp::socket socket_;
-			boost::asio::io_service::strand strand_;
 			std::function<void(const boost::system::error_code&)> error_handler_;
+			std::shared_ptr<detail::metrics> metrics_;
+			std::shared_ptr<detail::tracer> tracer_;
+			std::shared_ptr<service_table> services_;
+			std::shared_ptr<limiter> limiter_;
+			std::shared_ptr<capturer> capturer_;
+			std::uint64_t capture_id_ = 0;
+			std::atomic<std::size_t> in_flight_{0};
+			bool admitted_ = false;
+			bool established_ = false;
 
 			std::mutex mutex_;
-			std::unordered_map<std::uint64_t, std::function<void(const std::string&)>> callback_map_;
-			std::uint64_t index_ = 0;
+			std::unordered_map<std::uint64_t, std::function<void(string_view)>> callback_map_;
+			std::uint64_t index_ = service_id::reserved;
+			std::unordered_map<std::uint64_t, pending_call> calls_;
+			std::unordered_map<std::uint64_t, std::uint64_t> callback_calls_;
+			std::uint64_t call_index_ = 1;
+
+			std::vector<char> read_buffer_;
+			std::size_t read_begin_ = 0;
+			std::size_t read_end_ = 0;
+			boost::asio::steady_timer resume_timer_;
+			std::atomic<bool> paused_{false};
+			std::unordered_map<std::uint64_t, std::vector<char>> fragments_;
+			std::size_t reassembling_ = 0;
+
+			std::mutex write_mutex_;
+			std::array<std::deque<outgoing>, priority_count> write_queues_;
+			buffer_pool buffer_pool_;
+			std::uint64_t stream_ = 0;
+			bool writing_ = false;
+
+			// owned by the write in progress
+			std::vector<outgoing> writing_frames_;
+			std::vector<active_span> finished_spans_;
+			std::vector<boost::asio::const_buffer> write_buffers_;
+			std::array<std::vector<char>, priority_count> fragment_headers_;
 		};
 	}
 }
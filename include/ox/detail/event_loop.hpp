@@ -0,0 +1,71 @@
+#pragma once
+#include "config.hpp"
+#include "metrics.hpp"
+#include <boost/asio.hpp>
+#include <chrono>
+#include <system_error>
+#include <thread>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace ox
+{
+	namespace detail
+	{
+		// runs io_service until it is stopped, spinning for busy_poll after each event before it blocks
+		inline void run(boost::asio::io_service& io_service, std::chrono::microseconds busy_poll, metrics& counters)
+		{
+			if (busy_poll == std::chrono::microseconds::zero())
+			{
+				io_service.run();
+				return;
+			}
+
+			auto last = std::chrono::steady_clock::now();
+
+			while (!io_service.stopped())
+			{
+				if (io_service.poll() != 0)
+				{
+					last = std::chrono::steady_clock::now();
+					continue;
+				}
+
+				if (counters.enabled())
+					counters.add(metrics::busy_polls);
+
+				if (busy_poll != std::chrono::microseconds::max() && std::chrono::steady_clock::now() - last >= busy_poll)
+				{
+					io_service.run_one();
+					last = std::chrono::steady_clock::now();
+				}
+			}
+		}
+
+		// throws std::system_error if the thread cannot be pinned
+		inline void pin_thread(std::thread& thread, int cpu)
+		{
+			if (cpu < 0)
+				return;
+
+#if defined(__linux__)
+			if (cpu >= CPU_SETSIZE)
+				throw std::system_error(std::make_error_code(std::errc::invalid_argument), "CPU pinning");
+
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(cpu, &set);
+
+			auto result = pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+			if (result != 0)
+				throw std::system_error(result, std::system_category(), "pthread_setaffinity_np");
+#else
+			(void)thread;
+			throw std::system_error(std::make_error_code(std::errc::not_supported), "CPU pinning");
+#endif
+		}
+	}
+}
@@ -0,0 +1,262 @@
+#pragma once
+#include "../view.hpp"
+#include <cereal/cereal.hpp>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+namespace ox
+{
+	namespace detail
+	{
+		// Hash of the wire layout of a type. Arithmetic types, enums, strings, functions, vectors and
+		// tuples are hashed at compile time; other types once at run time.
+		template <class Value, class = void>
+		struct fingerprint_of;
+
+		template <class Value>
+		constexpr std::uint64_t fingerprint()
+		{
+			return fingerprint_of<std::decay_t<Value>>::value();
+		}
+
+		constexpr std::uint64_t fingerprint_combine(std::uint64_t seed, std::uint64_t value)
+		{
+			return (seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2))) * 0x100000001b3ull;
+		}
+
+		template <class... Values>
+		constexpr std::uint64_t fingerprint_sequence(std::uint64_t seed)
+		{
+			const std::uint64_t values[] = {0, fingerprint<Values>()...};
+
+			for (auto value : values)
+				seed = fingerprint_combine(seed, value);
+
+			return seed;
+		}
+
+		// typeid names differ between compilers and standard libraries, so peers built with
+		// different toolchains disagree on fingerprints which fall back to them
+		template <class Value>
+		std::uint64_t fingerprint_name()
+		{
+			std::uint64_t result = 'n';
+
+			for (auto p = typeid(Value).name(); *p != '\0'; ++p)
+				result = fingerprint_combine(result, static_cast<std::uint8_t>(*p));
+
+			return result;
+		}
+
+		// the number of classes being walked on this thread
+		inline int& fingerprint_depth()
+		{
+			thread_local int depth = 0;
+			return depth;
+		}
+
+		class fingerprint_archive
+		{
+		public:
+			template <class... Values>
+			fingerprint_archive& operator()(Values&&... /*values*/)
+			{
+				value_ = fingerprint_sequence<Values...>(value_);
+				return *this;
+			}
+
+			std::uint64_t value() const
+			{
+				return value_;
+			}
+
+		private:
+			std::uint64_t value_ = 'c';
+		};
+
+		template <class Value, class = void>
+		struct has_member_serialize : std::false_type
+		{
+		};
+
+		template <class Value>
+		struct has_member_serialize<Value, decltype(std::declval<Value&>().serialize(std::declval<fingerprint_archive&>()), void())> : std::true_type
+		{
+		};
+
+		template <class Value, class = void>
+		struct has_free_serialize : std::false_type
+		{
+		};
+
+		template <class Value>
+		struct has_free_serialize<Value, decltype(serialize(std::declval<fingerprint_archive&>(), std::declval<Value&>()), void())> : std::true_type
+		{
+		};
+
+		// classes are walked through their serialize function; types serialized by other means,
+		// such as save and load functions, are only told apart by their name (see fingerprint_name)
+		template <class Value, class>
+		struct fingerprint_of
+		{
+			static std::uint64_t value()
+			{
+				using walked = std::integral_constant<bool, std::is_default_constructible<Value>::value && (has_member_serialize<Value>::value || has_free_serialize<Value>::value)>;
+
+				// a type which contains itself is hashed as a back reference; this is checked before
+				// the static, whose initialization would otherwise be reentered
+				if (visiting())
+					return 'r';
+
+				// within another type, back references are relative to that root, so the value is
+				// only cached when this type is the root, and is the same whichever type is hashed first
+				if (fingerprint_depth() != 0)
+					return compute(walked());
+
+				static const std::uint64_t result = compute(walked());
+				return result;
+			}
+
+		private:
+			static bool& visiting()
+			{
+				thread_local bool result = false;
+				return result;
+			}
+
+			struct visit
+			{
+				visit()
+				{
+					visiting() = true;
+					++fingerprint_depth();
+				}
+
+				~visit()
+				{
+					visiting() = false;
+					--fingerprint_depth();
+				}
+			};
+
+			static std::uint64_t compute(std::true_type)
+			{
+				visit v;
+
+				Value value{};
+				fingerprint_archive ar;
+				walk(ar, value, has_member_serialize<Value>());
+
+				return ar.value();
+			}
+
+			static std::uint64_t compute(std::false_type)
+			{
+				return fingerprint_name<Value>();
+			}
+
+			static void walk(fingerprint_archive& ar, Value& value, std::true_type)
+			{
+				value.serialize(ar);
+			}
+
+			static void walk(fingerprint_archive& ar, Value& value, std::false_type)
+			{
+				serialize(ar, value);
+			}
+		};
+
+		template <class Value>
+		struct fingerprint_of<Value, typename std::enable_if<std::is_arithmetic<Value>::value>::type>
+		{
+			static constexpr std::uint64_t value()
+			{
+				return fingerprint_combine(std::is_floating_point<Value>::value ? 'f' : std::is_signed<Value>::value ? 'i' : 'u', sizeof(Value));
+			}
+		};
+
+		// enums are sent as their underlying type
+		template <class Value>
+		struct fingerprint_of<Value, typename std::enable_if<std::is_enum<Value>::value>::type>
+		{
+			static constexpr std::uint64_t value()
+			{
+				return fingerprint<std::underlying_type_t<Value>>();
+			}
+		};
+
+		template <>
+		struct fingerprint_of<std::string>
+		{
+			static constexpr std::uint64_t value()
+			{
+				return 's';
+			}
+		};
+
+		// views are sent as the types they view
+		template <>
+		struct fingerprint_of<string_view>
+		{
+			static constexpr std::uint64_t value()
+			{
+				return 's';
+			}
+		};
+
+		template <class Value>
+		struct fingerprint_of<array_view<Value>>
+		{
+			static std::uint64_t value()
+			{
+				// views of other types are sent as raw memory, unlike vectors
+				if (std::is_arithmetic<Value>::value)
+					return fingerprint<std::vector<std::remove_const_t<Value>>>();
+
+				return fingerprint_combine(fingerprint_combine('b', sizeof(Value)), fingerprint_name<std::remove_const_t<Value>>());
+			}
+		};
+
+		template <class Result, class... Arguments>
+		struct fingerprint_of<std::function<Result(Arguments...)>>
+		{
+			static constexpr std::uint64_t value()
+			{
+				return fingerprint_sequence<Arguments...>('F');
+			}
+		};
+
+		template <class Value, class Allocator>
+		struct fingerprint_of<std::vector<Value, Allocator>>
+		{
+			static constexpr std::uint64_t value()
+			{
+				return fingerprint_combine('v', fingerprint<Value>());
+			}
+		};
+
+		template <class... Values>
+		struct fingerprint_of<std::tuple<Values...>>
+		{
+			static constexpr std::uint64_t value()
+			{
+				return fingerprint_sequence<Values...>('t');
+			}
+		};
+
+		template <class Value>
+		struct fingerprint_of<cereal::NameValuePair<Value>>
+		{
+			static constexpr std::uint64_t value()
+			{
+				return fingerprint<Value>();
+			}
+		};
+	}
+}
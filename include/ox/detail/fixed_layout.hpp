@@ -0,0 +1,65 @@
+#pragma once
+#include <array>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace ox
+{
+	namespace detail
+	{
+		// Tuples of arithmetic values are written as their packed native representation, which is
+		// the same byte sequence the archives produce field by field.
+		template <class... Values>
+		struct is_fixed_layout : std::true_type
+		{
+		};
+
+		template <class Value, class... Values>
+		struct is_fixed_layout<Value, Values...>
+			: std::integral_constant<bool, std::is_arithmetic<Value>::value && is_fixed_layout<Values...>::value>
+		{
+		};
+
+		template <class... Values>
+		constexpr std::size_t packed_size()
+		{
+			const std::size_t sizes[] = {0, sizeof(Values)...};
+
+			std::size_t result = 0;
+			for (auto size : sizes)
+				result += size;
+
+			return result;
+		}
+
+		template <std::size_t Index, class... Values>
+		constexpr std::size_t packed_offset()
+		{
+			const std::size_t sizes[] = {0, sizeof(Values)...};
+
+			std::size_t result = 0;
+			for (std::size_t i = 0; i < Index; ++i)
+				result += sizes[i + 1];
+
+			return result;
+		}
+
+		template <class... Values, std::size_t... Indices>
+		void pack(char* data, const std::tuple<Values...>& values, std::index_sequence<Indices...>)
+		{
+			using dummy = int[];
+			(void)dummy{0, (std::memcpy(data + packed_offset<Indices, Values...>(), &std::get<Indices>(values), sizeof(Values)), 0)...};
+			(void)data;
+		}
+
+		template <class... Values, std::size_t... Indices>
+		void unpack(const char* data, std::tuple<Values...>& values, std::index_sequence<Indices...>)
+		{
+			using dummy = int[];
+			(void)dummy{0, (std::memcpy(&std::get<Indices>(values), data + packed_offset<Indices, Values...>(), sizeof(Values)), 0)...};
+			(void)data;
+		}
+	}
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include "integer_codec.hpp"
+#include "trace.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ox
+{
+	namespace detail
+	{
+		// The wire format, shared by connections and by tools which read or write frames.
+		// A frame is [trace marker, trace id, span id,] callback id, size and payload. Integers are
+		// one byte below 0x80, or a type byte followed by 1, 2, 4 or 8 bytes in big endian.
+
+		// precedes the frame header when a trace context is attached; not a valid integer prefix
+		const std::uint8_t trace_marker = 0xd4;
+
+		// starts a fragment of a frame which is larger than fragment_size:
+		// marker, stream id, size and a part of the encoded frame
+		const std::uint8_t fragment_marker = 0xd5;
+
+		const std::size_t fragment_size = 16 * 1024;
+
+		// marker, trace and span ids, callback id and size
+		const std::size_t max_header_size = 1 + 4 * 9;
+
+		struct frame_header
+		{
+			trace_context context;
+			std::uint64_t id = 0;
+			std::uint64_t size = 0;
+			std::size_t length = 0;
+		};
+
+		struct fragment_header
+		{
+			std::uint64_t stream = 0;
+			std::uint64_t size = 0;
+			std::size_t length = 0;
+		};
+
+		const std::size_t signature_size = 3;
+
+		// the last byte is the protocol version
+		inline const std::array<char, signature_size>& get_signature()
+		{
+			static const std::array<char, signature_size> signature = {{0x6f, 0x78, 0x02}};
+			return signature;
+		}
+
+		// sent by a server instead of its signature when it refuses the connection
+		inline const std::array<char, signature_size>& get_overloaded_signature()
+		{
+			static const std::array<char, signature_size> signature = {{0x6f, 0x78, static_cast<char>(0xff)}};
+			return signature;
+		}
+
+		inline void write_integer(std::vector<char>& buffer, std::uint64_t value)
+		{
+			char encoded[max_integer_size];
+			buffer.insert(buffer.end(), encoded, encode_integer(encoded, value));
+		}
+
+		// p needs max_header_size bytes of room
+		inline char* encode_header(char* p, const trace_context& context, std::uint64_t id, std::uint64_t size)
+		{
+			if (context)
+			{
+				*p++ = static_cast<char>(trace_marker);
+				p = encode_integer(p, context.trace_id);
+				p = encode_integer(p, context.span_id);
+			}
+
+			p = encode_integer(p, id);
+			return encode_integer(p, size);
+		}
+
+		// p needs max_header_size bytes of room
+		inline char* encode_fragment_header(char* p, std::uint64_t stream, std::uint64_t size)
+		{
+			*p++ = static_cast<char>(fragment_marker);
+			p = encode_integer(p, stream);
+			return encode_integer(p, size);
+		}
+
+		inline parse_result parse_fragment_header(const char* begin, const char* end, fragment_header& header)
+		{
+			auto p = begin + 1;
+			parse_result result;
+
+			if ((result = decode_integer(p, end, header.stream)) != parse_result::complete)
+				return result;
+
+			if ((result = decode_integer(p, end, header.size)) != parse_result::complete)
+				return result;
+
+			if (header.size > fragment_size)
+				return parse_result::invalid;
+
+			header.length = static_cast<std::size_t>(p - begin);
+
+			return parse_result::complete;
+		}
+
+		inline parse_result parse_header(const char* begin, const char* end, frame_header& header)
+		{
+			auto p = begin;
+			parse_result result;
+
+			header.context = trace_context();
+
+			if (p != end && static_cast<std::uint8_t>(*p) == trace_marker)
+			{
+				++p;
+
+				if ((result = decode_integer(p, end, header.context.trace_id)) != parse_result::complete)
+					return result;
+
+				if ((result = decode_integer(p, end, header.context.span_id)) != parse_result::complete)
+					return result;
+			}
+
+			if ((result = decode_integer(p, end, header.id)) != parse_result::complete)
+				return result;
+
+			if ((result = decode_integer(p, end, header.size)) != parse_result::complete)
+				return result;
+
+			header.length = static_cast<std::size_t>(p - begin);
+
+			return parse_result::complete;
+		}
+	}
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace ox
+{
+	namespace detail
+	{
+		enum class parse_result
+		{
+			complete,
+			incomplete,
+			invalid,
+		};
+
+		// an encoded integer takes at most this many bytes, and encode_integer writes as many
+		const std::size_t max_integer_size = 9;
+
+		inline std::uint64_t byte_swap(std::uint64_t value)
+		{
+#if defined(__GNUC__) || defined(__clang__)
+			return __builtin_bswap64(value);
+#else
+			std::uint64_t result = 0;
+
+			for (int i = 0; i < 8; ++i)
+			{
+				result = (result << 8) | (value & 0xff);
+				value >>= 8;
+			}
+
+			return result;
+#endif
+		}
+
+		inline bool is_little_endian()
+		{
+#if defined(__BYTE_ORDER__)
+			return __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__;
+#else
+			const std::uint16_t value = 1;
+			return *reinterpret_cast<const std::uint8_t*>(&value) == 1;
+#endif
+		}
+
+		// the width in bytes of the integer following a type byte: 1, 2, 4 or 8
+		inline std::size_t integer_width(std::uint64_t value)
+		{
+			if (value < 0x100)
+				return 1;
+
+			if (value < 0x10000)
+				return 2;
+
+			return value < 0x100000000 ? 4 : 8;
+		}
+
+		inline std::size_t integer_size(std::uint64_t value)
+		{
+			return value < 0x80 ? 1 : 1 + integer_width(value);
+		}
+
+		// writes the type byte and the value as one 8 byte big endian store; p needs
+		// max_integer_size bytes of room, of which the bytes beyond the returned end are garbage
+		inline char* encode_integer(char* p, std::uint64_t value)
+		{
+			if (value < 0x80)
+			{
+				*p = static_cast<char>(value);
+				return p + 1;
+			}
+
+			auto width = integer_width(value);
+
+			// 0xcc, 0xcd, 0xce and 0xcf for 1, 2, 4 and 8 bytes
+			*p = static_cast<char>(0xcc + (width == 1 ? 0 : width == 2 ? 1 : width == 4 ? 2 : 3));
+
+			auto shifted = value << (64 - 8 * width);
+			auto stored = is_little_endian() ? byte_swap(shifted) : shifted;
+			std::memcpy(p + 1, &stored, sizeof(stored));
+
+			return p + 1 + width;
+		}
+
+		// reads a big endian integer of width bytes with one unaligned load when
+		// at least 8 bytes are readable from p
+		inline std::uint64_t load_big_endian(const char* p, std::size_t width, std::size_t available)
+		{
+			if (available >= sizeof(std::uint64_t))
+			{
+				std::uint64_t loaded;
+				std::memcpy(&loaded, p, sizeof(loaded));
+
+				auto value = is_little_endian() ? byte_swap(loaded) : loaded;
+
+				return width == 8 ? value : value >> (64 - 8 * width);
+			}
+
+			std::uint64_t value = 0;
+
+			for (std::size_t i = 0; i < width; ++i)
+				value = (value << 8) | static_cast<std::uint8_t>(p[i]);
+
+			return value;
+		}
+
+		inline parse_result decode_integer(const char*& p, const char* end, std::uint64_t& value)
+		{
+			if (p == end)
+				return parse_result::incomplete;
+
+			auto type = static_cast<std::uint8_t>(*p);
+
+			if (type < 0x80)
+			{
+				value = type;
+				++p;
+				return parse_result::complete;
+			}
+
+			if ((type & 0xfc) != 0xcc)
+				return parse_result::invalid;
+
+			std::size_t width = std::size_t(1) << (type - 0xcc);
+			auto available = static_cast<std::size_t>(end - p) - 1;
+
+			if (available < width)
+				return parse_result::incomplete;
+
+			value = load_big_endian(p + 1, width, available);
+			p += 1 + width;
+
+			return parse_result::complete;
+		}
+	}
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include "../limits.hpp"
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace ox
+{
+	namespace detail
+	{
+		// Connection count and memory in use across the connections of a host
+		class limiter
+		{
+		public:
+			explicit limiter(const load_limits& limits)
+				: limits_(limits)
+			{
+			}
+
+			limiter(const limiter&) = delete;
+			limiter& operator=(const limiter&) = delete;
+
+			const load_limits& limits() const
+			{
+				return limits_;
+			}
+
+			// false for the default limits, which need no accounting
+			bool enabled() const
+			{
+				return limits_.max_connections != 0 || limits_.max_in_flight_bytes != 0 || limits_.max_callbacks != 0 || limits_.memory_budget != 0;
+			}
+
+			bool try_open()
+			{
+				auto n = connections_.fetch_add(1, std::memory_order_relaxed);
+
+				if (limits_.max_connections != 0 && n >= limits_.max_connections)
+				{
+					connections_.fetch_sub(1, std::memory_order_relaxed);
+					return false;
+				}
+
+				return true;
+			}
+
+			void close()
+			{
+				connections_.fetch_sub(1, std::memory_order_relaxed);
+			}
+
+			// memory is only counted across connections if there is a budget
+			void acquire(std::size_t bytes)
+			{
+				if (limits_.memory_budget != 0)
+					used_.fetch_add(bytes);
+			}
+
+			// fails instead of taking the memory in use past the budget
+			bool try_acquire(std::size_t bytes)
+			{
+				if (limits_.memory_budget == 0)
+					return true;
+
+				auto used = used_.load();
+
+				do
+				{
+					if (used >= limits_.memory_budget || bytes > limits_.memory_budget - used)
+						return false;
+				} while (!used_.compare_exchange_weak(used, used + bytes));
+
+				return true;
+			}
+
+			void release(std::size_t bytes)
+			{
+				if (limits_.memory_budget == 0)
+					return;
+
+				used_.fetch_sub(bytes);
+
+				if (waiting_.load() && !exhausted())
+					notify();
+			}
+
+			// waiter is called once, on the thread which brings the memory in use below the budget;
+			// the caller checks exhausted() again afterwards, since memory may have been freed before
+			void wait(std::function<void()> waiter)
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				waiters_.push_back(std::move(waiter));
+				waiting_.store(true);
+			}
+
+			bool exhausted() const
+			{
+				return limits_.memory_budget != 0 && used_.load() >= limits_.memory_budget;
+			}
+
+		private:
+			void notify()
+			{
+				std::vector<std::function<void()>> waiters;
+
+				{
+					std::lock_guard<std::mutex> lock(mutex_);
+					waiters.swap(waiters_);
+					waiting_.store(false);
+				}
+
+				for (const auto& waiter : waiters)
+					waiter();
+			}
+
+			load_limits limits_;
+			std::atomic<std::size_t> connections_{0};
+			std::atomic<std::size_t> used_{0};
+
+			std::mutex mutex_;
+			std::vector<std::function<void()>> waiters_;
+			std::atomic<bool> waiting_{false};
+		};
+	}
+}
@@ -0,0 +1,200 @@
+#pragma once
+#include "../metrics.hpp"
+#include "slot_pool.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace ox
+{
+	namespace detail
+	{
+		// Counters are kept in per-thread shards which are written by their owner thread only,
+		// so the hot path is a plain relaxed load and store. Shards are summed on snapshot().
+		class metrics
+		{
+		public:
+			enum counter
+			{
+				connections_opened,
+				connections_closed,
+				handshake_failures,
+				frames_sent,
+				frames_received,
+				bytes_sent,
+				bytes_received,
+				callbacks_registered,
+				callbacks_released,
+				writes_queued,
+				writes_completed,
+				connections_rejected,
+				calls_rejected,
+				reads_paused,
+				busy_polls,
+				counter_count,
+			};
+
+			// gauges go up and down, so they are kept even while disabled
+			enum gauge
+			{
+				live_callbacks,
+				write_queue_depth,
+				gauge_count,
+			};
+
+			metrics()
+				: id_(next_id()++)
+				, slot_(slots().acquire())
+			{
+			}
+
+			~metrics()
+			{
+				slots().release(slot_);
+			}
+
+			metrics(const metrics&) = delete;
+			metrics& operator=(const metrics&) = delete;
+
+			bool enabled() const
+			{
+				return enabled_.load(std::memory_order_relaxed);
+			}
+
+			void enable(bool enable)
+			{
+				enabled_.store(enable, std::memory_order_relaxed);
+			}
+
+			void add(counter c, std::uint64_t value = 1)
+			{
+				increment(local().counters[c], value);
+			}
+
+			void adjust(gauge g, std::int64_t delta)
+			{
+				// wraps around, and the shards sum up to the signed value
+				increment(local().gauges[g], static_cast<std::uint64_t>(delta));
+			}
+
+			void record_dispatch(std::chrono::steady_clock::duration duration)
+			{
+				auto ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count());
+
+				std::size_t index = 0;
+				while (index < histogram_snapshot::bucket_count - 1 && (ns >> index) != 0)
+					++index;
+
+				auto& s = local();
+				increment(s.buckets[index], 1);
+				increment(s.sum, ns);
+			}
+
+			metrics_snapshot snapshot() const
+			{
+				std::array<std::uint64_t, counter_count> counters{};
+				std::array<std::uint64_t, gauge_count> gauges{};
+				metrics_snapshot result;
+
+				std::lock_guard<std::mutex> lock(mutex_);
+
+				for (const auto& s : shards_)
+				{
+					for (std::size_t i = 0; i < counter_count; ++i)
+						counters[i] += s->counters[i].load(std::memory_order_relaxed);
+
+					for (std::size_t i = 0; i < gauge_count; ++i)
+						gauges[i] += s->gauges[i].load(std::memory_order_relaxed);
+
+					for (std::size_t i = 0; i < histogram_snapshot::bucket_count; ++i)
+					{
+						auto n = s->buckets[i].load(std::memory_order_relaxed);
+						result.dispatch_latency.buckets[i] += n;
+						result.dispatch_latency.count += n;
+					}
+
+					result.dispatch_latency.sum += s->sum.load(std::memory_order_relaxed);
+				}
+
+				result.connections_opened = counters[connections_opened];
+				result.connections_closed = counters[connections_closed];
+				result.handshake_failures = counters[handshake_failures];
+				result.frames_sent = counters[frames_sent];
+				result.frames_received = counters[frames_received];
+				result.bytes_sent = counters[bytes_sent];
+				result.bytes_received = counters[bytes_received];
+				result.callbacks_registered = counters[callbacks_registered];
+				result.callbacks_released = counters[callbacks_released];
+				result.live_callbacks = static_cast<std::int64_t>(gauges[live_callbacks]);
+				result.writes_queued = counters[writes_queued];
+				result.writes_completed = counters[writes_completed];
+				result.write_queue_depth = static_cast<std::int64_t>(gauges[write_queue_depth]);
+				result.connections_rejected = counters[connections_rejected];
+				result.calls_rejected = counters[calls_rejected];
+				result.reads_paused = counters[reads_paused];
+				result.busy_polls = counters[busy_polls];
+
+				return result;
+			}
+
+		private:
+			struct shard
+			{
+				std::array<std::atomic<std::uint64_t>, counter_count> counters{};
+				std::array<std::atomic<std::uint64_t>, gauge_count> gauges{};
+				std::array<std::atomic<std::uint64_t>, histogram_snapshot::bucket_count> buckets{};
+				std::atomic<std::uint64_t> sum{0};
+			};
+
+			static std::atomic<std::uint64_t>& next_id()
+			{
+				static std::atomic<std::uint64_t> id{0};
+				return id;
+			}
+
+			// indexes the per-thread shard caches
+			static slot_pool& slots()
+			{
+				static slot_pool pool;
+				return pool;
+			}
+
+			static void increment(std::atomic<std::uint64_t>& value, std::uint64_t n)
+			{
+				value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+			}
+
+			shard& local()
+			{
+				// indexed by slot, so the cache grows with the registries alive at once; the id tells
+				// the shard of a destroyed registry which held the same slot apart
+				thread_local std::vector<std::pair<std::uint64_t, shard*>> cache;
+
+				if (slot_ < cache.size() && cache[slot_].second && cache[slot_].first == id_)
+					return *cache[slot_].second;
+
+				std::lock_guard<std::mutex> lock(mutex_);
+
+				shards_.push_back(std::make_unique<shard>());
+
+				if (cache.size() <= slot_)
+					cache.resize(slot_ + 1);
+
+				cache[slot_] = std::make_pair(id_, shards_.back().get());
+
+				return *shards_.back();
+			}
+
+			std::uint64_t id_;
+			std::size_t slot_;
+			std::atomic<bool> enabled_{false};
+
+			mutable std::mutex mutex_;
+			std::vector<std::unique_ptr<shard>> shards_;
+		};
+	}
+}
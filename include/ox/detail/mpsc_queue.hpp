@@ -0,0 +1,106 @@
+#pragma once
+#include <atomic>
+#include <utility>
+
+namespace ox
+{
+	namespace detail
+	{
+		// Unbounded queue which any number of threads push to and one thread pops from.
+		// push is wait free; pop may miss an element whose push is still in progress,
+		// which becomes visible once that push returns.
+		template <class T>
+		class mpsc_queue
+		{
+		public:
+			mpsc_queue()
+				: head_(&stub_)
+				, tail_(&stub_)
+			{
+			}
+
+			~mpsc_queue()
+			{
+				T value;
+				while (pop(value))
+				{
+				}
+			}
+
+			mpsc_queue(const mpsc_queue&) = delete;
+			mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+			void push(T value)
+			{
+				auto n = new node(std::move(value));
+				link(n);
+			}
+
+			// called on the consumer thread only
+			bool pop(T& value)
+			{
+				auto tail = tail_;
+				auto next = tail->next.load(std::memory_order_acquire);
+
+				// skips the stub, which marks an empty queue
+				if (tail == &stub_)
+				{
+					if (!next)
+						return false;
+
+					tail_ = next;
+					tail = next;
+					next = next->next.load(std::memory_order_acquire);
+				}
+
+				if (next)
+				{
+					tail_ = next;
+					value = std::move(tail->value);
+					delete tail;
+					return true;
+				}
+
+				// the last node stays until another one follows it
+				if (tail != head_.load(std::memory_order_acquire))
+					return false;
+
+				link(&stub_);
+
+				next = tail->next.load(std::memory_order_acquire);
+				if (!next)
+					return false;
+
+				tail_ = next;
+				value = std::move(tail->value);
+				delete tail;
+				return true;
+			}
+
+		private:
+			struct node
+			{
+				node() = default;
+
+				explicit node(T&& v)
+					: value(std::move(v))
+				{
+				}
+
+				std::atomic<node*> next{nullptr};
+				T value;
+			};
+
+			void link(node* n)
+			{
+				n->next.store(nullptr, std::memory_order_relaxed);
+				auto previous = head_.exchange(n, std::memory_order_acq_rel);
+				previous->next.store(n, std::memory_order_release);
+			}
+
+			std::atomic<node*> head_;
+			node* tail_;
+			node stub_;
+		};
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include "../view.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace ox
+{
+	namespace detail
+	{
+		class connection;
+
+		// Entry points of a host, shared by all of its connections and looked up on each initial call
+		class service_table
+		{
+		public:
+			typedef std::function<void(const std::shared_ptr<connection>&, string_view)> entry_type;
+
+			// fallback receives calls to ids which are not served
+			explicit service_table(const entry_type& fallback)
+				: fallback_(fallback)
+			{
+			}
+
+			void add(std::uint64_t id, const entry_type& entry)
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				entries_[id] = entry;
+			}
+
+			entry_type find(std::uint64_t id) const
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+
+				auto it = entries_.find(id);
+				if (it == entries_.end())
+					return fallback_;
+
+				return it->second;
+			}
+
+		private:
+			entry_type fallback_;
+			mutable std::mutex mutex_;
+			std::unordered_map<std::uint64_t, entry_type> entries_;
+		};
+	}
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace ox
+{
+	namespace detail
+	{
+		// Small indices for objects which threads keep per-object state for in a thread_local
+		// array; a released slot goes to the next object, so the arrays grow with the objects
+		// alive at once rather than with all objects ever created.
+		class slot_pool
+		{
+		public:
+			std::size_t acquire()
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+
+				if (free_.empty())
+					return count_++;
+
+				auto slot = free_.back();
+				free_.pop_back();
+
+				return slot;
+			}
+
+			void release(std::size_t slot)
+			{
+				std::lock_guard<std::mutex> lock(mutex_);
+				free_.push_back(slot);
+			}
+
+		private:
+			std::mutex mutex_;
+			std::vector<std::size_t> free_;
+			std::size_t count_ = 0;
+		};
+	}
+}
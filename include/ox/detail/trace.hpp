@@ -0,0 +1,138 @@
+#pragma once
+#include "../trace.hpp"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <random>
+
+namespace ox
+{
+	namespace detail
+	{
+		struct trace_context
+		{
+			std::uint64_t trace_id = 0;
+			std::uint64_t span_id = 0;
+
+			explicit operator bool() const
+			{
+				return trace_id != 0;
+			}
+		};
+
+		struct active_span
+		{
+			trace_context context;
+			std::uint64_t parent_id = 0;
+			const char* name = "";
+			std::chrono::steady_clock::time_point start;
+
+			explicit operator bool() const
+			{
+				return static_cast<bool>(context);
+			}
+		};
+
+		class tracer
+		{
+		public:
+			tracer() = default;
+			tracer(const tracer&) = delete;
+			tracer& operator=(const tracer&) = delete;
+
+			bool enabled() const
+			{
+				return enabled_.load(std::memory_order_relaxed);
+			}
+
+			void set_sink(const std::shared_ptr<trace_sink>& sink)
+			{
+				std::atomic_store(&sink_, sink);
+				enabled_.store(static_cast<bool>(sink), std::memory_order_relaxed);
+			}
+
+			// returns an empty span when tracing is disabled; a span without parent starts a new trace
+			active_span start(const char* name, const trace_context& parent)
+			{
+				active_span result;
+
+				if (!enabled())
+					return result;
+
+				result.context.trace_id = parent ? parent.trace_id : next_id();
+				result.context.span_id = next_id();
+				result.parent_id = parent.span_id;
+				result.name = name;
+				result.start = std::chrono::steady_clock::now();
+
+				return result;
+			}
+
+			void finish(const active_span& s)
+			{
+				if (!s)
+					return;
+
+				auto sink = std::atomic_load(&sink_);
+				if (!sink)
+					return;
+
+				span result;
+				result.trace_id = s.context.trace_id;
+				result.span_id = s.context.span_id;
+				result.parent_id = s.parent_id;
+				result.name = s.name;
+				result.start = s.start;
+				result.end = std::chrono::steady_clock::now();
+
+				sink->record(result);
+			}
+
+			// context of the span which is running on this thread, propagated to calls made from it
+			static trace_context& current()
+			{
+				thread_local trace_context context;
+				return context;
+			}
+
+		private:
+			static std::uint64_t next_id()
+			{
+				static const std::uint64_t seed = std::random_device()() * 0x100000000ull + std::random_device()();
+				static std::atomic<std::uint64_t> counter{0};
+
+				// splitmix64 keeps ids from two processes apart without coordination
+				auto z = seed + 0x9e3779b97f4a7c15ull * ++counter;
+				z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+				z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+				z ^= z >> 31;
+
+				return z != 0 ? z : 1;
+			}
+
+			std::atomic<bool> enabled_{false};
+			std::shared_ptr<trace_sink> sink_;
+		};
+
+		class trace_scope
+		{
+		public:
+			explicit trace_scope(const trace_context& context)
+				: previous_(tracer::current())
+			{
+				tracer::current() = context;
+			}
+
+			trace_scope(const trace_scope&) = delete;
+			trace_scope& operator=(const trace_scope&) = delete;
+
+			~trace_scope()
+			{
+				tracer::current() = previous_;
+			}
+
+		private:
+			trace_context previous_;
+		};
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <boost/system/error_code.hpp>
+#include <string>
+
+namespace ox
+{
+	// errors reported by the remote side of a call; the values are sent over the wire
+	enum class errc
+	{
+		schema_mismatch = 1,
+		unknown_service = 2,
+		overloaded = 3,
+	};
+
+	namespace detail
+	{
+		class error_category_impl : public boost::system::error_category
+		{
+		public:
+			const char* name() const noexcept override
+			{
+				return "ox";
+			}
+
+			std::string message(int value) const override
+			{
+				switch (static_cast<errc>(value))
+				{
+				case errc::schema_mismatch:
+					return "function types of client and server do not match";
+				case errc::unknown_service:
+					return "no such service";
+				case errc::overloaded:
+					return "server is overloaded";
+				default:
+					return "unknown error";
+				}
+			}
+		};
+	}
+
+	inline const boost::system::error_category& error_category()
+	{
+		static const detail::error_category_impl category;
+		return category;
+	}
+
+	inline boost::system::error_code make_error_code(errc e)
+	{
+		return boost::system::error_code(static_cast<int>(e), error_category());
+	}
+}
+
+namespace boost
+{
+	namespace system
+	{
+		template <>
+		struct is_error_code_enum<ox::errc>
+		{
+			static const bool value = true;
+		};
+	}
+}
@@ -0,0 +1,219 @@
+#pragma once
+#include "capture.hpp"
+#include "detail/archive.hpp"
+#include "detail/call.hpp"
+#include "detail/capture.hpp"
+#include "detail/connection.hpp"
+#include "detail/event_loop.hpp"
+#include "detail/fingerprint.hpp"
+#include "detail/limiter.hpp"
+#include "detail/metrics.hpp"
+#include "detail/service_table.hpp"
+#include "detail/trace.hpp"
+#include "error.hpp"
+#include "io_options.hpp"
+#include "limits.hpp"
+#include "metrics.hpp"
+#include "service.hpp"
+#include "trace.hpp"
+#include "view.hpp"
+#include <boost/asio.hpp>
+#include <memory>
+#include <thread>
+
+namespace ox
+{
+	// Serves any number of entry points on one port, one thread and one connection per client
+	class host
+	{
+	public:
+		explicit host(unsigned short port = 21872, const io_options& options = io_options(), const load_limits& limits = load_limits())
+			: options_(options)
+			, limiter_(std::make_shared<detail::limiter>(limits))
+			, acceptor_(io_service_, local_endpoint(port))
+		{
+			accept();
+			thread_ = std::thread(std::bind(&host::run, this));
+
+			try
+			{
+				detail::pin_thread(thread_, options_.cpu);
+			}
+			catch (...)
+			{
+				io_service_.stop();
+				thread_.join();
+				throw;
+			}
+		}
+
+		~host()
+		{
+			io_service_.stop();
+			thread_.join();
+		}
+
+		// the function type is given explicitly, e.g. add<void(int)>("name", handler)
+		template <class Function, class Handler>
+		void add(service_id id, Handler handler)
+		{
+			services_->add(id.value(), make_entry(std::function<Function>(handler)));
+		}
+
+		void enable_metrics(bool enable = true)
+		{
+			metrics_->enable(enable);
+		}
+
+		metrics_snapshot metrics() const
+		{
+			return metrics_->snapshot();
+		}
+
+		// returns the sink so that the default ring buffer can be read back
+		std::shared_ptr<trace_sink> enable_tracing(std::shared_ptr<trace_sink> sink = std::make_shared<ring_buffer_trace_sink>())
+		{
+			tracer_->set_sink(sink);
+			return sink;
+		}
+
+		void disable_tracing()
+		{
+			tracer_->set_sink(nullptr);
+		}
+
+		// frames of all connections are passed to sink, including their payloads
+		void enable_capture(const std::shared_ptr<capture_sink>& sink)
+		{
+			capturer_->set_sink(sink);
+		}
+
+		void disable_capture()
+		{
+			capturer_->set_sink(nullptr);
+		}
+
+	private:
+		static boost::asio::ip::tcp::endpoint local_endpoint(unsigned short port)
+		{
+			return boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v6(), port);
+		}
+
+		template <class Result, class... Arguments>
+		static detail::service_table::entry_type make_entry(const std::function<Result(Arguments...)>& function)
+		{
+			static_assert(std::is_void<Result>::value, "It is not allowed to use return value since it is difficult to gurantee returning");
+
+			typedef std::function<void(Arguments...)> function_type;
+
+			auto fingerprint = detail::fingerprint<function_type>();
+
+			return [function, fingerprint](const std::shared_ptr<detail::connection>& c, string_view str) {
+				detail::iarchive ia(str, c);
+
+				detail::call_prologue prologue;
+				std::function<void(const function_type&)> receiver;
+
+				bool accepted = false;
+
+				try
+				{
+					ia(prologue);
+
+					accepted = c->accept_call();
+
+					if (accepted && prologue.fingerprint == fingerprint)
+						ia(receiver);
+				}
+				catch (...)
+				{
+					return;
+				}
+
+				if (!receiver)
+				{
+					prologue.error(static_cast<int>(accepted ? errc::schema_mismatch : errc::overloaded));
+					release_receiver(ia);
+					return;
+				}
+
+				receiver(function);
+			};
+		}
+
+		// the receiver of a rejected call is not loaded, but released so that the client
+		// drops it together with the arguments it holds
+		static void release_receiver(detail::iarchive& ia)
+		{
+			try
+			{
+				ia.release_function();
+			}
+			catch (...)
+			{
+			}
+		}
+
+		static void reject(const std::shared_ptr<detail::connection>& c, string_view str)
+		{
+			detail::iarchive ia(str, c);
+
+			detail::call_prologue prologue;
+
+			try
+			{
+				ia(prologue);
+			}
+			catch (...)
+			{
+				return;
+			}
+
+			prologue.error(static_cast<int>(errc::unknown_service));
+			release_receiver(ia);
+		}
+
+		void accept()
+		{
+			auto c = std::make_shared<detail::connection>(io_service_, [](const auto& /*ec*/) {}, metrics_, tracer_);
+			c->serve(services_);
+			if (limiter_->enabled())
+				c->limit(limiter_);
+			c->capture(capturer_);
+
+			acceptor_.async_accept(c->socket(), [=](const auto& ec) {
+				if (ec == boost::asio::error::operation_aborted)
+					return;
+
+				if (!ec)
+				{
+					c->configure(options_);
+					c->handshake_server([=](const auto& ec) {
+						if (ec)
+							return;
+
+						c->receive([](const auto& /*ec*/) {
+						});
+					});
+				}
+
+				this->accept();
+			});
+		}
+
+		void run()
+		{
+			detail::run(io_service_, options_.busy_poll, *metrics_);
+		}
+
+		std::shared_ptr<detail::service_table> services_ = std::make_shared<detail::service_table>(&host::reject);
+		std::shared_ptr<detail::metrics> metrics_ = std::make_shared<detail::metrics>();
+		std::shared_ptr<detail::tracer> tracer_ = std::make_shared<detail::tracer>();
+		std::shared_ptr<detail::capturer> capturer_ = std::make_shared<detail::capturer>();
+		io_options options_;
+		std::shared_ptr<detail::limiter> limiter_;
+		boost::asio::io_service io_service_;
+		boost::asio::ip::tcp::acceptor acceptor_;
+		std::thread thread_;
+	};
+}
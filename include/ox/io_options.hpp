@@ -0,0 +1,29 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+
+namespace ox
+{
+	// Tuning of an I/O thread and of the sockets it serves
+	struct io_options
+	{
+		// the thread keeps polling for this long after the last event before it blocks;
+		// microseconds::max() spins forever and dedicates a core to the thread
+		std::chrono::microseconds busy_poll = std::chrono::microseconds::zero();
+
+		// CPU which the thread is pinned to, or -1 to leave it to the scheduler;
+		// the threads of a client context are pinned to consecutive CPUs from this one
+		int cpu = -1;
+
+		// I/O threads of a client context, each with its own connection per peer; 0 counts as 1.
+		// Hosts run a single thread.
+		std::size_t threads = 1;
+
+		// disables Nagle's algorithm so that small frames are sent at once
+		bool no_delay = true;
+
+		// SO_BUSY_POLL of each socket in microseconds (Linux only, values above
+		// net.core.busy_read need CAP_NET_ADMIN and are ignored otherwise); 0 keeps the default
+		int socket_busy_poll = 0;
+	};
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstddef>
+
+namespace ox
+{
+	// Limits of a host under load; zero means unlimited.
+	// Calls and connections over a limit fail on the client with errc::overloaded.
+	struct load_limits
+	{
+		// further connections are refused during the handshake
+		std::size_t max_connections = 0;
+
+		// bytes a connection holds for frames being received or waiting to be sent;
+		// above it the connection stops reading and rejects calls, and larger frames close it
+		std::size_t max_in_flight_bytes = 0;
+
+		// calls are rejected while a connection has this many callbacks registered
+		std::size_t max_callbacks = 0;
+
+		// in-flight bytes of all connections together, with the same effect when exceeded
+		std::size_t memory_budget = 0;
+	};
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace ox
+{
+	struct histogram_snapshot
+	{
+		// buckets[i] counts samples below 2^i nanoseconds not counted by a lower bucket; the last one is unbounded
+		static const std::size_t bucket_count = 40;
+
+		std::array<std::uint64_t, bucket_count> buckets{};
+		std::uint64_t count = 0;
+		std::uint64_t sum = 0;
+	};
+
+	struct metrics_snapshot
+	{
+		std::uint64_t connections_opened = 0;
+		std::uint64_t connections_closed = 0;
+		std::uint64_t handshake_failures = 0;
+
+		std::uint64_t frames_sent = 0;
+		std::uint64_t frames_received = 0;
+		std::uint64_t bytes_sent = 0;
+		std::uint64_t bytes_received = 0;
+
+		std::uint64_t callbacks_registered = 0;
+		std::uint64_t callbacks_released = 0;
+		std::int64_t live_callbacks = 0;
+
+		std::uint64_t writes_queued = 0;
+		std::uint64_t writes_completed = 0;
+		std::int64_t write_queue_depth = 0;
+
+		// load shedding, see load_limits
+		std::uint64_t connections_rejected = 0;
+		std::uint64_t calls_rejected = 0;
+		std::uint64_t reads_paused = 0;
+
+		// polls of busy-polling I/O threads which found no event, see io_options
+		std::uint64_t busy_polls = 0;
+
+		histogram_snapshot dispatch_latency;
+	};
+
+	namespace detail
+	{
+		inline void write_prometheus_metric(std::ostream& os, const std::string& name, const char* type, std::int64_t value)
+		{
+			os << "# TYPE " << name << ' ' << type << '\n';
+			os << name << ' ' << value << '\n';
+		}
+	}
+
+	inline void write_prometheus(std::ostream& os, const metrics_snapshot& snapshot, const std::string& prefix = "ox")
+	{
+		auto counter = [&](const char* name, std::uint64_t value) {
+			detail::write_prometheus_metric(os, prefix + "_" + name + "_total", "counter", static_cast<std::int64_t>(value));
+		};
+
+		auto gauge = [&](const char* name, std::int64_t value) {
+			detail::write_prometheus_metric(os, prefix + "_" + name, "gauge", value);
+		};
+
+		counter("connections_opened", snapshot.connections_opened);
+		counter("connections_closed", snapshot.connections_closed);
+		counter("handshake_failures", snapshot.handshake_failures);
+		counter("frames_sent", snapshot.frames_sent);
+		counter("frames_received", snapshot.frames_received);
+		counter("bytes_sent", snapshot.bytes_sent);
+		counter("bytes_received", snapshot.bytes_received);
+		counter("callbacks_registered", snapshot.callbacks_registered);
+		counter("callbacks_released", snapshot.callbacks_released);
+		gauge("live_callbacks", snapshot.live_callbacks);
+		gauge("write_queue_depth", snapshot.write_queue_depth);
+		counter("connections_rejected", snapshot.connections_rejected);
+		counter("calls_rejected", snapshot.calls_rejected);
+		counter("reads_paused", snapshot.reads_paused);
+		counter("busy_polls", snapshot.busy_polls);
+
+		const auto& h = snapshot.dispatch_latency;
+		auto name = prefix + "_dispatch_latency_seconds";
+
+		os << "# TYPE " << name << " histogram\n";
+
+		std::uint64_t cumulative = 0;
+
+		for (std::size_t i = 0; i < h.bucket_count - 1; ++i)
+		{
+			cumulative += h.buckets[i];
+			os << name << "_bucket{le=\"" << static_cast<double>(std::uint64_t(1) << i) * 1e-9 << "\"} " << cumulative << '\n';
+		}
+
+		os << name << "_bucket{le=\"+Inf\"} " << h.count << '\n';
+		os << name << "_sum " << static_cast<double>(h.sum) * 1e-9 << '\n';
+		os << name << "_count " << h.count << '\n';
+	}
+}
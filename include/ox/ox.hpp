@@ -1,3 +1,9 @@
 #pragma once
+#include "capture.hpp"
 #include "client.hpp"
+#include "client_context.hpp"
+#include "error.hpp"
+#include "host.hpp"
+#include "io_options.hpp"
+#include "limits.hpp"
 #include "server.hpp"
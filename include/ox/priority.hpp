@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace ox
+{
+	// Outbound lane of a frame. Higher lanes are always sent first, and frames larger
+	// than a fragment are split so that they do not hold back frames of higher lanes.
+	enum class priority : std::uint8_t
+	{
+		high,
+		normal,
+		low,
+	};
+
+	namespace detail
+	{
+		static const std::size_t priority_count = 3;
+
+		inline std::size_t lane_index(priority value)
+		{
+			return static_cast<std::size_t>(value);
+		}
+	}
+}
@@ -1,9 +1,12 @@
 #pragma once
-#include "detail/archive.hpp"
-#include "detail/connection.hpp"
-#include <boost/asio.hpp>
+#include "capture.hpp"
+#include "host.hpp"
+#include "io_options.hpp"
+#include "limits.hpp"
+#include "metrics.hpp"
+#include "service.hpp"
+#include "trace.hpp"
 #include <memory>
-#include <thread>
 
 namespace ox
 {
@@ -18,68 +21,44 @@ namespace ox
 
 		typedef std::function<void(Arguments...)> function_type;
 
-		explicit server(function_type function, unsigned short port = 21872)
-			: function_(function)
-			, acceptor_(io_service_, local_endpoint(port))
+		explicit server(function_type function, unsigned short port = 21872, const io_options& options = io_options(), const load_limits& limits = load_limits())
+			: host_(port, options, limits)
 		{
-			accept();
-			thread_ = std::thread(std::bind(&server::run, this));
+			host_.add<Result(Arguments...)>(service_id(), function);
 		}
 
-		~server()
+		void enable_metrics(bool enable = true)
 		{
-			io_service_.stop();
-			thread_.join();
+			host_.enable_metrics(enable);
 		}
 
-	private:
-		static boost::asio::ip::tcp::endpoint local_endpoint(unsigned short port)
+		metrics_snapshot metrics() const
 		{
-			return boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v6(), port);
+			return host_.metrics();
 		}
 
-		void accept()
+		// returns the sink so that the default ring buffer can be read back
+		std::shared_ptr<trace_sink> enable_tracing(std::shared_ptr<trace_sink> sink = std::make_shared<ring_buffer_trace_sink>())
 		{
-			auto f = function_;
-			auto c = std::make_shared<detail::connection>(io_service_, [](const auto& /*ec*/) {});
-
-			c->resgister_callback([=](const auto& str) {
-				std::istringstream is(str);
-				detail::iarchive ia(is, c);
-
-				std::function<void(const function_type&)> receiver;
-				ia(receiver);
-
-				receiver(f);
-			});
-
-			acceptor_.async_accept(c->socket(), [=](const auto& ec) {
-				if (ec == boost::asio::error::operation_aborted)
-					return;
-
-				if (!ec)
-				{
-					c->handshake_server([=](const auto& ec) {
-						if (ec)
-							return;
+			return host_.enable_tracing(sink);
+		}
 
-						c->receive([](const auto& /*ec*/) {
-						});
-					});
-				}
+		void disable_tracing()
+		{
+			host_.disable_tracing();
+		}
 
-				this->accept();
-			});
+		void enable_capture(const std::shared_ptr<capture_sink>& sink)
+		{
+			host_.enable_capture(sink);
 		}
 
-		void run()
+		void disable_capture()
 		{
-			io_service_.run();
+			host_.disable_capture();
 		}
 
-		function_type function_;
-		boost::asio::io_service io_service_;
-		boost::asio::ip::tcp::acceptor acceptor_;
-		std::thread thread_;
+	private:
+		host host_;
 	};
 }
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+namespace ox
+{
+	// Identifies an entry point of a host, either by a small compile-time number or by name.
+	// Service ids share the id space of callbacks on a connection, so both kinds are kept
+	// out of the range used for registered callbacks.
+	class service_id
+	{
+	public:
+		// numeric ids must be less than this; callbacks are numbered from here on
+		static const std::uint64_t reserved = 64;
+
+		constexpr service_id()
+			: id_(0)
+		{
+		}
+
+		template <class Integer, class = typename std::enable_if<std::is_integral<Integer>::value>::type>
+		constexpr service_id(Integer id)
+			: id_(static_cast<std::uint64_t>(id) < reserved ? static_cast<std::uint64_t>(id) : throw std::out_of_range("service id must be less than service_id::reserved"))
+		{
+		}
+
+		constexpr service_id(const char* name)
+			: id_(hash(name) | named_bit)
+		{
+		}
+
+		constexpr std::uint64_t value() const
+		{
+			return id_;
+		}
+
+		static constexpr bool is_reserved(std::uint64_t id)
+		{
+			return id < reserved || (id & named_bit) != 0;
+		}
+
+	private:
+		static const std::uint64_t named_bit = 0x8000000000000000ull;
+
+		// FNV-1a
+		static constexpr std::uint64_t hash(const char* name)
+		{
+			std::uint64_t result = 0xcbf29ce484222325ull;
+
+			for (; *name != '\0'; ++name)
+			{
+				result ^= static_cast<std::uint8_t>(*name);
+				result *= 0x100000001b3ull;
+			}
+
+			return result;
+		}
+
+		std::uint64_t id_;
+	};
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace ox
+{
+	struct span
+	{
+		std::uint64_t trace_id = 0;
+		std::uint64_t span_id = 0;
+		std::uint64_t parent_id = 0;
+		const char* name = "";
+		std::chrono::steady_clock::time_point start;
+		std::chrono::steady_clock::time_point end;
+	};
+
+	class trace_sink
+	{
+	public:
+		virtual ~trace_sink() = default;
+
+		// called from I/O threads and from the threads which issue calls
+		virtual void record(const span& s) = 0;
+	};
+
+	class ring_buffer_trace_sink : public trace_sink
+	{
+	public:
+		explicit ring_buffer_trace_sink(std::size_t capacity = 4096)
+			: buffer_(capacity)
+		{
+		}
+
+		void record(const span& s) override
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+
+			if (buffer_.empty())
+				return;
+
+			buffer_[next_ % buffer_.size()] = s;
+			++next_;
+		}
+
+		// oldest first
+		std::vector<span> spans() const
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+
+			std::vector<span> result;
+
+			auto size = next_ < buffer_.size() ? next_ : buffer_.size();
+
+			for (auto i = next_ - size; i != next_; ++i)
+				result.push_back(buffer_[i % buffer_.size()]);
+
+			return result;
+		}
+
+	private:
+		mutable std::mutex mutex_;
+		std::vector<span> buffer_;
+		std::size_t next_ = 0;
+	};
+}
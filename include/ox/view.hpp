@@ -0,0 +1,126 @@
+#pragma once
+#include <boost/utility/string_view.hpp>
+#include <cstddef>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace ox
+{
+	// As arguments of a handler, views refer to the received frame and are valid during the call only.
+	// On the wire they are the same as std::string and std::vector respectively.
+	typedef boost::string_view string_view;
+
+	template <class Value>
+	class array_view
+	{
+	public:
+		static_assert(std::is_trivially_copyable<Value>::value, "array_view is only available for trivially copyable types");
+
+		typedef Value value_type;
+		typedef Value* iterator;
+
+		array_view() = default;
+
+		array_view(Value* data, std::size_t size)
+			: data_(data)
+			, size_(size)
+		{
+		}
+
+		// views of const values refer to any vector, mutable views to mutable ones only
+		template <class Allocator, class V = Value, std::enable_if_t<std::is_const<V>::value, int> = 0>
+		array_view(const std::vector<std::remove_const_t<Value>, Allocator>& values)
+			: data_(values.data())
+			, size_(values.size())
+		{
+		}
+
+		template <class Allocator>
+		array_view(std::vector<std::remove_const_t<Value>, Allocator>& values)
+			: data_(values.data())
+			, size_(values.size())
+		{
+		}
+
+		Value* data() const
+		{
+			return data_;
+		}
+
+		std::size_t size() const
+		{
+			return size_;
+		}
+
+		bool empty() const
+		{
+			return size_ == 0;
+		}
+
+		Value* begin() const
+		{
+			return data_;
+		}
+
+		Value* end() const
+		{
+			return data_ + size_;
+		}
+
+		Value& operator[](std::size_t index) const
+		{
+			return data_[index];
+		}
+
+	private:
+		Value* data_ = nullptr;
+		std::size_t size_ = 0;
+	};
+
+	namespace detail
+	{
+		// the type which keeps a copy of an argument until it is sent
+		template <class Value>
+		struct owning
+		{
+			typedef Value type;
+
+			static const Value& convert(const Value& value)
+			{
+				return value;
+			}
+		};
+
+		template <>
+		struct owning<string_view>
+		{
+			typedef std::string type;
+
+			static type convert(string_view value)
+			{
+				return type(value.data(), value.size());
+			}
+		};
+
+		template <class Value>
+		struct owning<array_view<Value>>
+		{
+			typedef std::vector<std::remove_const_t<Value>> type;
+
+			static type convert(array_view<Value> value)
+			{
+				return type(value.begin(), value.end());
+			}
+		};
+
+		template <class Value>
+		using owning_t = typename owning<std::decay_t<Value>>::type;
+
+		template <class Value>
+		owning_t<Value> to_owning(const Value& value)
+		{
+			return owning<std::decay_t<Value>>::convert(value);
+		}
+	}
+}
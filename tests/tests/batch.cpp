@@ -0,0 +1,85 @@
+#include "wait_until.hpp"
+#include <atomic>
+#include <boost/asio.hpp>
+#include <catch.hpp>
+#include <future>
+#include <ox/ox.hpp>
+#include <thread>
+#include <vector>
+
+TEST_CASE("batch")
+{
+	using function_type = void(std::uint64_t, const std::string&, std::function<void(std::uint64_t, std::size_t)>);
+
+	ox::server<function_type> server([](auto index, const auto& str, auto f) {
+		f(index, str.size());
+	});
+
+	ox::client<function_type> client("localhost");
+
+	using namespace std::chrono_literals;
+
+	SECTION("many small frames share reads and writes")
+	{
+		const std::uint64_t n = 1000;
+
+		std::atomic<std::uint64_t> sum(0);
+		std::atomic<std::uint64_t> count(0);
+		std::promise<void> done;
+
+		for (std::uint64_t i = 0; i < n; ++i)
+		{
+			client(i, "x", [&](auto index, auto /*size*/) {
+				sum += index;
+
+				if (++count == n)
+					done.set_value();
+			});
+		}
+
+		REQUIRE(done.get_future().wait_for(5s) == std::future_status::ready);
+
+		CHECK(sum == n * (n - 1) / 2);
+	}
+
+	SECTION("a frame larger than the read buffer")
+	{
+		std::promise<std::size_t> result;
+		auto f = result.get_future();
+
+		client(0, std::string(1024 * 1024, 'x'), [&](auto /*index*/, auto size) {
+			result.set_value(size);
+		});
+
+		REQUIRE(f.wait_for(5s) == std::future_status::ready);
+
+		CHECK(f.get() == 1024 * 1024);
+	}
+
+	SECTION("a frame larger than any buffer closes the connection")
+	{
+		server.enable_metrics();
+
+		boost::asio::io_service io_service;
+		boost::asio::ip::tcp::socket socket(io_service);
+		socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 21872));
+
+		boost::asio::write(socket, boost::asio::buffer(ox::detail::get_signature()));
+
+		std::array<char, ox::detail::signature_size> signature;
+		boost::asio::read(socket, boost::asio::buffer(signature));
+
+		// a size near 2^64, followed by more than a read buffer of filler
+		std::vector<char> frame;
+		ox::detail::write_integer(frame, 0);
+		ox::detail::write_integer(frame, 0xfffffffffffffffe);
+		frame.resize(frame.size() + 70 * 1024, 'x');
+
+		boost::system::error_code ec;
+		boost::asio::write(socket, boost::asio::buffer(frame), ec);
+
+		CHECK(wait_until([&]() {
+			return server.metrics().connections_closed == 1;
+		}));
+	}
+}
@@ -0,0 +1,67 @@
+#include <catch.hpp>
+#include <cstdio>
+#include <future>
+#include <ox/ox.hpp>
+
+TEST_CASE("capture")
+{
+	using function_type = void(const std::string&, std::function<void(const std::string&)>);
+
+	const std::string path = "ox_capture_test.bin";
+
+	{
+		auto file = std::make_shared<ox::capture_file>(path);
+
+		ox::server<function_type> server([](const auto& str, auto f) {
+			f(str + str);
+		});
+
+		server.enable_capture(file);
+
+		ox::client<function_type> client("localhost");
+
+		std::promise<std::string> result;
+		auto f = result.get_future();
+
+		client("abc", [&](const auto& str) {
+			result.set_value(str);
+		});
+
+		using namespace std::chrono_literals;
+		REQUIRE(f.wait_for(1s) == std::future_status::ready);
+		CHECK(f.get() == "abcabc");
+
+		std::this_thread::sleep_for(100ms);
+
+		server.disable_capture();
+		file->flush();
+	}
+
+	ox::capture_reader reader(path);
+	ox::captured_frame frame;
+
+	std::vector<ox::captured_frame> received;
+	std::size_t sent = 0;
+	std::chrono::nanoseconds last(0);
+
+	while (reader.next(frame))
+	{
+		CHECK(frame.connection == 0);
+		CHECK(frame.time >= last);
+		last = frame.time;
+
+		if (frame.received)
+			received.push_back(frame);
+		else
+			++sent;
+	}
+
+	// the call first, and the arguments once the server invoked the receiver
+	REQUIRE(received.size() >= 2);
+	CHECK(received[0].id == 0);
+	CHECK(received[0].size > 0);
+	CHECK(received[1].id >= static_cast<std::uint64_t>(ox::service_id::reserved));
+	CHECK(sent >= 2);
+
+	std::remove(path.c_str());
+}
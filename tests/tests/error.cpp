@@ -1,20 +1,154 @@
+#include <boost/asio.hpp>
 #include <catch.hpp>
+#include <cstring>
 #include <future>
+#include <limits>
 #include <ox/ox.hpp>
+#include <thread>
+#include <vector>
 
 TEST_CASE("error")
 {
-	ox::client<void()> client("0.0.0.0");
+	using namespace std::chrono_literals;
 
-	std::promise<boost::system::error_code> error;
-	auto f = error.get_future();
+	SECTION("the peer cannot be reached")
+	{
+		ox::client<void()> client("0.0.0.0");
 
-	client([&](const auto& ec) {
-		error.set_value(ec);
-	});
+		std::promise<boost::system::error_code> error;
+		auto f = error.get_future();
 
-	using namespace std::chrono_literals;
-	REQUIRE(f.wait_for(1s) == std::future_status::ready);
+		client([&](const auto& ec) {
+			error.set_value(ec);
+		});
+
+		REQUIRE(f.wait_for(1s) == std::future_status::ready);
+
+		CHECK(f.get());
+	}
+
+	SECTION("the peer drops the connection during a call")
+	{
+		boost::asio::io_service io_service;
+		boost::asio::ip::tcp::acceptor acceptor(io_service, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), 21873));
+
+		// completes the handshake, reads the call and closes the socket without answering
+		std::thread peer([&]() {
+			boost::asio::ip::tcp::socket socket(io_service);
+			acceptor.accept(socket);
+
+			std::array<char, ox::detail::signature_size> signature;
+			boost::asio::read(socket, boost::asio::buffer(signature));
+			boost::asio::write(socket, boost::asio::buffer(ox::detail::get_signature()));
+
+			std::array<char, 1> call;
+			boost::asio::read(socket, boost::asio::buffer(call));
+
+			socket.close();
+		});
+
+		ox::client<void(std::function<void()>)> client("localhost", 21873);
+
+		std::promise<boost::system::error_code> error;
+		auto f = error.get_future();
+
+		client([]() {}, [&](const auto& ec) {
+			error.set_value(ec);
+		});
+
+		REQUIRE(f.wait_for(1s) == std::future_status::ready);
+		peer.join();
+
+		// end of file, or a reset if the rest of the call was still unread
+		CHECK(f.get());
+	}
+
+	SECTION("the peer drops the connection while it holds a reply callback")
+	{
+		using function_type = void(int, std::function<void(int)>);
+
+		boost::asio::io_service io_service;
+		boost::asio::ip::tcp::acceptor acceptor(io_service, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), 21873));
+
+		// acts as a host which accepts the call, invokes the receiver and keeps the reply callback
+		std::thread peer([&]() {
+			boost::asio::ip::tcp::socket socket(io_service);
+			acceptor.accept(socket);
+
+			std::array<char, ox::detail::signature_size> signature;
+			boost::asio::read(socket, boost::asio::buffer(signature));
+			boost::asio::write(socket, boost::asio::buffer(ox::detail::get_signature()));
+
+			std::vector<char> buffer;
+
+			auto read_frame = [&]() {
+				ox::detail::frame_header header;
+
+				for (;;)
+				{
+					if (ox::detail::parse_header(buffer.data(), buffer.data() + buffer.size(), header) == ox::detail::parse_result::complete && buffer.size() - header.length >= header.size)
+						break;
+
+					std::array<char, 1024> data;
+					auto n = socket.read_some(boost::asio::buffer(data));
+					buffer.insert(buffer.end(), data.begin(), data.begin() + n);
+				}
+
+				std::vector<char> payload(buffer.begin() + header.length, buffer.begin() + header.length + header.size);
+				buffer.erase(buffer.begin(), buffer.begin() + header.length + header.size);
+
+				return payload;
+			};
+
+			// the fingerprint, the error callback and the receiver, each callback an id and a lane
+			auto call = read_frame();
+
+			std::uint64_t error_callback;
+			std::uint64_t receiver;
+			std::memcpy(&error_callback, call.data() + sizeof(std::uint64_t), sizeof(error_callback));
+			std::memcpy(&receiver, call.data() + ox::detail::call_receiver_offset, sizeof(receiver));
+
+			// the receiver is passed the host's function as callback 1000 in the normal lane
+			std::vector<char> frame;
+			ox::detail::write_integer(frame, receiver);
+			ox::detail::write_integer(frame, sizeof(std::uint64_t) + 1);
+
+			std::uint64_t function = 1000;
+			frame.insert(frame.end(), reinterpret_cast<const char*>(&function), reinterpret_cast<const char*>(&function) + sizeof(function));
+			frame.push_back(static_cast<char>(ox::priority::normal));
+
+			boost::asio::write(socket, boost::asio::buffer(frame));
+
+			// the client calls the function, passing the reply callback
+			read_frame();
+
+			// the host releases the receiver and the error callback, but not the reply callback
+			frame.clear();
+
+			for (auto id : {error_callback, receiver})
+			{
+				ox::detail::write_integer(frame, id);
+				ox::detail::write_integer(frame, std::numeric_limits<std::uint64_t>::max());
+			}
+
+			boost::asio::write(socket, boost::asio::buffer(frame));
+
+			socket.shutdown(boost::asio::ip::tcp::socket::shutdown_send);
+			socket.close();
+		});
+
+		ox::client<function_type> client("localhost", 21873);
+
+		std::promise<boost::system::error_code> error;
+		auto f = error.get_future();
+
+		client(1, [](auto /*x*/) {}, [&](const auto& ec) {
+			error.set_value(ec);
+		});
+
+		REQUIRE(f.wait_for(1s) == std::future_status::ready);
+		peer.join();
 
-	CHECK(f.get());
+		CHECK(f.get());
+	}
 }
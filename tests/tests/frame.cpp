@@ -0,0 +1,60 @@
+#include <catch.hpp>
+#include <limits>
+#include <ox/detail/frame.hpp>
+#include <vector>
+
+TEST_CASE("frame")
+{
+	using namespace ox::detail;
+
+	SECTION("integers round trip at every width boundary")
+	{
+		const std::uint64_t values[] = {0, 0x7f, 0x80, 0xff, 0x100, 0xffff, 0x10000, 0xffffffff, 0x100000000, std::numeric_limits<std::uint64_t>::max()};
+
+		for (auto value : values)
+		{
+			std::vector<char> buffer;
+			write_integer(buffer, value);
+
+			CHECK(buffer.size() == integer_size(value));
+
+			const char* p = buffer.data();
+			std::uint64_t decoded = 0;
+
+			CHECK(decode_integer(p, buffer.data() + buffer.size(), decoded) == parse_result::complete);
+			CHECK(decoded == value);
+			CHECK(p == buffer.data() + buffer.size());
+
+			// every shorter prefix is incomplete
+			for (std::size_t size = 0; size < buffer.size(); ++size)
+			{
+				p = buffer.data();
+				CHECK(decode_integer(p, buffer.data() + size, decoded) == parse_result::incomplete);
+			}
+		}
+
+		const char invalid[] = {static_cast<char>(0xc0), 0};
+		const char* p = invalid;
+		std::uint64_t decoded;
+
+		CHECK(decode_integer(p, invalid + sizeof(invalid), decoded) == parse_result::invalid);
+	}
+
+	SECTION("headers round trip")
+	{
+		trace_context context;
+		context.trace_id = 0x123456789;
+		context.span_id = 0x80;
+
+		char buffer[max_header_size];
+		auto end = encode_header(buffer, context, 300, 5);
+
+		frame_header header;
+		CHECK(parse_header(buffer, end, header) == parse_result::complete);
+		CHECK(header.context.trace_id == context.trace_id);
+		CHECK(header.context.span_id == context.span_id);
+		CHECK(header.id == 300);
+		CHECK(header.size == 5);
+		CHECK(header.length == static_cast<std::size_t>(end - buffer));
+	}
+}
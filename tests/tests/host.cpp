@@ -0,0 +1,63 @@
+#include <catch.hpp>
+#include <future>
+#include <ox/ox.hpp>
+
+TEST_CASE("host")
+{
+	using add_type = void(int, int, std::function<void(int)>);
+	using echo_type = void(const std::string&, std::function<void(const std::string&)>);
+
+	ox::host host;
+
+	host.add<add_type>("add", [](auto x, auto y, auto f) {
+		f(x + y);
+	});
+
+	host.add<echo_type>(1, [](const auto& str, auto f) {
+		f(str + str);
+	});
+
+	auto context = std::make_shared<ox::client_context>();
+	context->enable_metrics();
+
+	ox::client<add_type> add(context, "localhost", 21872, "add");
+	ox::client<echo_type> echo(context, "localhost", 21872, 1);
+
+	std::promise<int> sum;
+	auto f1 = sum.get_future();
+
+	std::promise<std::string> str;
+	auto f2 = str.get_future();
+
+	add(1, 2, [&](auto x) {
+		sum.set_value(x);
+	});
+
+	echo("ox", [&](auto x) {
+		str.set_value(x);
+	});
+
+	using namespace std::chrono_literals;
+	REQUIRE(f1.wait_for(1s) == std::future_status::ready);
+	REQUIRE(f2.wait_for(1s) == std::future_status::ready);
+
+	CHECK(f1.get() == 3);
+	CHECK(f2.get() == "oxox");
+
+	// both clients went through the same pooled connection
+	CHECK(context->metrics().connections_opened == 1);
+}
+
+TEST_CASE("service_id")
+{
+	constexpr ox::service_id named("name");
+	constexpr ox::service_id numbered(3);
+
+	static_assert(ox::service_id::is_reserved(named.value()), "");
+	static_assert(ox::service_id::is_reserved(numbered.value()), "");
+	static_assert(!ox::service_id::is_reserved(ox::service_id::reserved), "");
+
+	CHECK(named.value() != ox::service_id("other").value());
+	CHECK(numbered.value() == 3);
+	CHECK_THROWS_AS(ox::service_id(ox::service_id::reserved), std::out_of_range);
+}
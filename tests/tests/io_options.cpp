@@ -0,0 +1,124 @@
+#include "wait_until.hpp"
+#include <catch.hpp>
+#include <future>
+#include <ox/ox.hpp>
+#include <pthread.h>
+#include <sched.h>
+
+namespace
+{
+	// whether the calling thread may run on cpu only
+	bool pinned_to(int cpu)
+	{
+		cpu_set_t set;
+		if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+			return false;
+
+		return CPU_COUNT(&set) == 1 && CPU_ISSET(cpu, &set) && sched_getcpu() == cpu;
+	}
+}
+
+TEST_CASE("io_options")
+{
+	using function_type = void(int, std::function<void(int)>);
+
+	using namespace std::chrono_literals;
+
+	ox::io_options options;
+	options.busy_poll = 1ms;
+	options.socket_busy_poll = 50;
+
+	SECTION("busy poll")
+	{
+		ox::server<function_type> server([](auto x, auto f) {
+			f(x + 1);
+		}, 21872, options);
+
+		ox::client<function_type> client("localhost", 21872, ox::service_id(), options);
+
+		server.enable_metrics();
+		client.enable_metrics();
+
+		for (int i = 0; i < 3; ++i)
+		{
+			std::promise<int> result;
+			auto f = result.get_future();
+
+			client(i, [&](auto x) {
+				result.set_value(x);
+			});
+
+			REQUIRE(f.wait_for(1s) == std::future_status::ready);
+			CHECK(f.get() == i + 1);
+
+			// lets the I/O threads fall back to blocking between calls
+			std::this_thread::sleep_for(5ms);
+		}
+
+		// both I/O threads polled without blocking after their events
+		CHECK(wait_until([&]() {
+			return server.metrics().busy_polls > 0 && client.metrics().busy_polls > 0;
+		}));
+	}
+
+	SECTION("no busy poll")
+	{
+		options.busy_poll = std::chrono::microseconds::zero();
+
+		ox::server<function_type> server([](auto x, auto f) {
+			f(x + 1);
+		}, 21872, options);
+
+		server.enable_metrics();
+
+		ox::client<function_type> client("localhost", 21872, ox::service_id(), options);
+
+		std::promise<int> result;
+		auto f = result.get_future();
+
+		client(1, [&](auto x) {
+			result.set_value(x);
+		});
+
+		REQUIRE(f.wait_for(1s) == std::future_status::ready);
+		CHECK(server.metrics().busy_polls == 0);
+	}
+
+	SECTION("pinning")
+	{
+		// a CPU which the process may run on, since CPU 0 can be outside its cpuset
+		cpu_set_t allowed;
+		REQUIRE(sched_getaffinity(0, sizeof(allowed), &allowed) == 0);
+
+		options.cpu = 0;
+		while (!CPU_ISSET(options.cpu, &allowed))
+			++options.cpu;
+
+		auto cpu = options.cpu;
+
+		// the handler runs on the thread of the server, and the reply callback on that of the client
+		ox::server<void(std::function<void(bool)>)> server([cpu](auto f) {
+			f(pinned_to(cpu));
+		}, 21872, options);
+
+		auto context = std::make_shared<ox::client_context>(options);
+		ox::client<void(std::function<void(bool)>)> client(context, "localhost");
+
+		std::promise<std::pair<bool, bool>> result;
+		auto f = result.get_future();
+
+		client([&](auto server_pinned) {
+			result.set_value(std::make_pair(server_pinned, pinned_to(cpu)));
+		});
+
+		REQUIRE(f.wait_for(1s) == std::future_status::ready);
+
+		auto pinned = f.get();
+		CHECK(pinned.first);
+		CHECK(pinned.second);
+
+		options.cpu = CPU_SETSIZE;
+
+		CHECK_THROWS_AS(ox::client_context(options), std::system_error);
+	}
+}
@@ -0,0 +1,276 @@
+#include "wait_until.hpp"
+#include <atomic>
+#include <boost/asio.hpp>
+#include <catch.hpp>
+#include <future>
+#include <mutex>
+#include <ox/ox.hpp>
+#include <thread>
+#include <vector>
+
+TEST_CASE("limits")
+{
+	using namespace std::chrono_literals;
+
+	SECTION("connections")
+	{
+		using function_type = void(int, std::function<void(int)>);
+
+		ox::load_limits limits;
+		limits.max_connections = 1;
+
+		ox::server<function_type> server([](auto x, auto f) {
+			f(x);
+		}, 21872, ox::io_options(), limits);
+
+		ox::client<function_type> first("localhost");
+		ox::client<function_type> second("localhost");
+
+		std::promise<int> result;
+		auto f = result.get_future();
+
+		first(1, [&](auto x) {
+			result.set_value(x);
+		});
+
+		REQUIRE(f.wait_for(1s) == std::future_status::ready);
+		CHECK(f.get() == 1);
+
+		std::promise<boost::system::error_code> error;
+		auto g = error.get_future();
+
+		second(2, [](auto /*x*/) {}, [&](const auto& ec) {
+			error.set_value(ec);
+		});
+
+		REQUIRE(g.wait_for(1s) == std::future_status::ready);
+		CHECK(g.get() == ox::errc::overloaded);
+	}
+
+	SECTION("callbacks")
+	{
+		// the client keeps the callbacks which the server passes to it
+		using function_type = void(std::function<void(std::function<void()>)>);
+
+		ox::load_limits limits;
+		limits.max_callbacks = 1;
+
+		ox::server<function_type> server([](auto f) {
+			f([]() {});
+		}, 21872, ox::io_options(), limits);
+
+		server.enable_metrics();
+
+		ox::client<function_type> client("localhost");
+		client.enable_metrics();
+
+		// the host releases the receivers of calls, whether it accepts them or not
+		auto released = [&]() {
+			return wait_until([&]() {
+				return client.metrics().live_callbacks == 0;
+			});
+		};
+
+		std::mutex mutex;
+		std::vector<std::function<void()>> kept;
+		std::promise<void> received;
+
+		client([&](auto f) {
+			std::lock_guard<std::mutex> lock(mutex);
+			kept.push_back(f);
+			received.set_value();
+		});
+
+		REQUIRE(received.get_future().wait_for(1s) == std::future_status::ready);
+
+		REQUIRE(released());
+
+		std::promise<boost::system::error_code> error;
+		auto g = error.get_future();
+
+		client([](auto /*f*/) {}, [&](const auto& ec) {
+			error.set_value(ec);
+		});
+
+		REQUIRE(g.wait_for(1s) == std::future_status::ready);
+		CHECK(g.get() == ox::errc::overloaded);
+		CHECK(server.metrics().calls_rejected == 1);
+		CHECK(released());
+
+		std::lock_guard<std::mutex> lock(mutex);
+		kept.clear();
+	}
+
+	SECTION("frame size")
+	{
+		using function_type = void(const std::string&);
+
+		ox::load_limits limits;
+		limits.max_in_flight_bytes = 64 * 1024;
+
+		std::atomic<int> calls(0);
+
+		ox::server<function_type> server([&](const auto& /*str*/) {
+			++calls;
+		}, 21872, ox::io_options(), limits);
+
+		server.enable_metrics();
+
+		ox::client<function_type> client("localhost");
+
+		client(std::string(1024 * 1024, 'x'));
+
+		CHECK(wait_until([&]() {
+			return server.metrics().connections_closed == 1;
+		}));
+		CHECK(calls == 0);
+	}
+
+	SECTION("memory budget")
+	{
+		using function_type = void(const std::string&);
+
+		// no per-connection limit, so only the budget bounds the frames received
+		ox::load_limits limits;
+		limits.memory_budget = 64 * 1024;
+
+		std::atomic<int> calls(0);
+
+		ox::server<function_type> server([&](const auto& /*str*/) {
+			++calls;
+		}, 21872, ox::io_options(), limits);
+
+		server.enable_metrics();
+
+		SECTION("a frame larger than the budget")
+		{
+			boost::asio::io_service io_service;
+			boost::asio::ip::tcp::socket socket(io_service);
+			socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 21872));
+
+			boost::asio::write(socket, boost::asio::buffer(ox::detail::get_signature()));
+
+			std::array<char, ox::detail::signature_size> signature;
+			boost::asio::read(socket, boost::asio::buffer(signature));
+
+			// the payload of 1 GiB is never allocated
+			std::vector<char> frame;
+			ox::detail::write_integer(frame, 0);
+			ox::detail::write_integer(frame, 1024 * 1024 * 1024);
+
+			boost::system::error_code ec;
+			boost::asio::write(socket, boost::asio::buffer(frame), ec);
+
+			CHECK(wait_until([&]() {
+				return server.metrics().connections_closed == 1;
+			}));
+		}
+
+		SECTION("fragments larger than the budget")
+		{
+			ox::client<function_type> client("localhost");
+
+			client(std::string(1024 * 1024, 'x'));
+
+			CHECK(wait_until([&]() {
+				return server.metrics().connections_closed == 1;
+			}));
+			CHECK(calls == 0);
+		}
+	}
+
+	SECTION("paused reads resume")
+	{
+		using function_type = void(int, std::function<void(const std::string&)>);
+
+		// every reply exceeds the budget, so the connection pauses reading until it is sent
+		ox::load_limits limits;
+		limits.memory_budget = 16 * 1024;
+
+		ox::server<function_type> server([](auto /*x*/, auto f) {
+			f(std::string(32 * 1024, 'x'));
+		}, 21872, ox::io_options(), limits);
+
+		server.enable_metrics();
+
+		ox::client<function_type> client("localhost");
+
+		const int n = 100;
+		std::atomic<int> replies(0);
+		std::promise<void> done;
+
+		for (int i = 0; i < n; ++i)
+		{
+			client(i, [&](const auto& /*str*/) {
+				if (++replies == n)
+					done.set_value();
+			});
+		}
+
+		REQUIRE(done.get_future().wait_for(5s) == std::future_status::ready);
+		CHECK(server.metrics().reads_paused > 0);
+	}
+
+	SECTION("fragment streams")
+	{
+		using function_type = void(const std::string&);
+
+		ox::load_limits limits;
+		limits.max_in_flight_bytes = 64 * 1024;
+
+		ox::server<function_type> server([](const auto& /*str*/) {}, 21872, ox::io_options(), limits);
+
+		server.enable_metrics();
+
+		boost::asio::io_service io_service;
+		boost::asio::ip::tcp::socket socket(io_service);
+		socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address_v4::loopback(), 21872));
+
+		boost::asio::write(socket, boost::asio::buffer(ox::detail::get_signature()));
+
+		std::array<char, ox::detail::signature_size> signature;
+		boost::asio::read(socket, boost::asio::buffer(signature));
+
+		// the first fragment of a frame which is never finished
+		auto fragment = [](std::uint64_t stream, std::size_t size) {
+			std::vector<char> frame;
+			ox::detail::write_integer(frame, 0);
+			ox::detail::write_integer(frame, 1024 * 1024);
+			frame.resize(size, 'x');
+
+			std::vector<char> result(ox::detail::max_header_size);
+			result.resize(ox::detail::encode_fragment_header(result.data(), stream, frame.size()) - result.data());
+			result.insert(result.end(), frame.begin(), frame.end());
+
+			return result;
+		};
+
+		auto closed = [&]() {
+			return wait_until([&]() {
+				return server.metrics().connections_closed == 1;
+			});
+		};
+
+		boost::system::error_code ec;
+
+		SECTION("more streams than lanes")
+		{
+			for (std::uint64_t stream = 0; stream <= ox::detail::priority_count; ++stream)
+				boost::asio::write(socket, boost::asio::buffer(fragment(stream, 16)), ec);
+
+			CHECK(closed());
+		}
+
+		SECTION("streams which together exceed the in-flight limit")
+		{
+			// each stream stays below the limit
+			for (std::uint64_t stream = 0; stream < ox::detail::priority_count; ++stream)
+			{
+				boost::asio::write(socket, boost::asio::buffer(fragment(stream, ox::detail::fragment_size)), ec);
+				boost::asio::write(socket, boost::asio::buffer(fragment(stream, ox::detail::fragment_size)), ec);
+			}
+
+			CHECK(closed());
+		}
+	}
+}
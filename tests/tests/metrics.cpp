@@ -0,0 +1,125 @@
+#include "wait_until.hpp"
+#include <catch.hpp>
+#include <future>
+#include <mutex>
+#include <ox/ox.hpp>
+#include <sstream>
+#include <thread>
+
+TEST_CASE("metrics")
+{
+	using function_type = void(int, std::function<void(int)>);
+
+	ox::server<function_type> server([](auto x, auto f) {
+		f(x + 1);
+	});
+
+	ox::client<function_type> client("localhost");
+
+	server.enable_metrics();
+	client.enable_metrics();
+
+	std::promise<int> result;
+	auto f = result.get_future();
+
+	client(1, [&](auto x) {
+		result.set_value(x);
+	});
+
+	using namespace std::chrono_literals;
+	REQUIRE(f.wait_for(1s) == std::future_status::ready);
+
+	CHECK(f.get() == 2);
+
+	// write completions may still be in flight when the result arrives
+	std::this_thread::sleep_for(100ms);
+
+	auto s = server.metrics();
+	CHECK(s.connections_opened == 1);
+	CHECK(s.frames_received >= 2);
+	CHECK(s.frames_sent >= 1);
+	CHECK(s.bytes_received > 0);
+	CHECK(s.dispatch_latency.count >= 2);
+
+	// the peers release the callbacks of the call once they drop them
+	CHECK(wait_until([&]() {
+		return client.metrics().live_callbacks == 0 && server.metrics().live_callbacks == 0;
+	}));
+
+	auto c = client.metrics();
+	CHECK(c.connections_opened == 1);
+	CHECK(c.frames_sent >= 2);
+	CHECK(c.callbacks_registered >= 2);
+	CHECK(c.live_callbacks == 0);
+
+	std::ostringstream os;
+	ox::write_prometheus(os, s);
+
+	CHECK(os.str().find("ox_connections_opened_total 1\n") != std::string::npos);
+	CHECK(os.str().find("ox_dispatch_latency_seconds_bucket{le=\"+Inf\"}") != std::string::npos);
+}
+
+TEST_CASE("metrics enabled during a call")
+{
+	using function_type = void(std::function<void()>);
+
+	std::mutex mutex;
+	std::function<void()> kept;
+	std::promise<void> received;
+
+	ox::server<function_type> server([&](auto f) {
+		std::lock_guard<std::mutex> lock(mutex);
+		kept = f;
+		received.set_value();
+	});
+
+	ox::client<function_type> client("localhost");
+
+	client([]() {});
+
+	using namespace std::chrono_literals;
+	REQUIRE(received.get_future().wait_for(1s) == std::future_status::ready);
+
+	// the callback which the server keeps was registered before metrics were enabled
+	client.enable_metrics();
+
+	CHECK(wait_until([&]() {
+		return client.metrics().live_callbacks == 1;
+	}));
+
+	client.enable_metrics(false);
+	client.enable_metrics();
+
+	CHECK(client.metrics().live_callbacks == 1);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		kept = nullptr;
+	}
+
+	CHECK(wait_until([&]() {
+		auto c = client.metrics();
+		return c.live_callbacks == 0 && c.write_queue_depth == 0;
+	}));
+}
+
+TEST_CASE("metrics registries")
+{
+	// a registry which takes the slot of a destroyed one starts from its own counters
+	for (int i = 0; i < 3; ++i)
+	{
+		ox::detail::metrics m;
+		m.add(ox::detail::metrics::frames_sent, 2);
+		m.add(ox::detail::metrics::frames_sent);
+
+		CHECK(m.snapshot().frames_sent == 3);
+	}
+
+	ox::detail::metrics a;
+	ox::detail::metrics b;
+	a.add(ox::detail::metrics::frames_received);
+	b.add(ox::detail::metrics::frames_received, 5);
+
+	CHECK(a.snapshot().frames_received == 1);
+	CHECK(b.snapshot().frames_received == 5);
+}
@@ -0,0 +1,110 @@
+#include <array>
+#include <boost/asio.hpp>
+#include <catch.hpp>
+#include <memory>
+#include <ox/ox.hpp>
+#include <thread>
+#include <vector>
+
+TEST_CASE("priority")
+{
+	const std::uint64_t bulk_id = ox::service_id::reserved;
+	const std::uint64_t control_id = ox::service_id::reserved + 1;
+	const std::size_t bulk_size = 1024 * 1024;
+
+	boost::asio::io_service io_service;
+	std::unique_ptr<boost::asio::io_service::work> work = std::make_unique<boost::asio::io_service::work>(io_service);
+
+	std::thread thread([&]() {
+		io_service.run();
+	});
+
+	// small socket buffers keep most of the bulk frame in its queue while the peer does not read
+	boost::asio::io_service peer_service;
+	boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), 21873);
+
+	boost::asio::ip::tcp::acceptor acceptor(peer_service);
+	acceptor.open(endpoint.protocol());
+	acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+	acceptor.set_option(boost::asio::socket_base::receive_buffer_size(16 * 1024));
+	acceptor.bind(endpoint);
+	acceptor.listen();
+
+	auto c = std::make_shared<ox::detail::connection>(io_service, [](const auto& /*ec*/) {}, std::make_shared<ox::detail::metrics>(), std::make_shared<ox::detail::tracer>());
+	c->socket().connect(endpoint);
+	c->socket().set_option(boost::asio::socket_base::send_buffer_size(16 * 1024));
+
+	boost::asio::ip::tcp::socket peer(peer_service);
+	acceptor.accept(peer);
+
+	std::vector<char> buffer;
+
+	auto read_some = [&]() {
+		std::array<char, 1024> data;
+		auto n = peer.read_some(boost::asio::buffer(data));
+		buffer.insert(buffer.end(), data.begin(), data.begin() + n);
+	};
+
+	c->invoke_remote(bulk_id, std::string(bulk_size, 'x'), ox::priority::low);
+
+	// the bulk frame is partly on the wire before the control frame is queued
+	while (buffer.empty())
+		read_some();
+
+	CHECK(static_cast<std::uint8_t>(buffer.front()) == ox::detail::fragment_marker);
+
+	c->invoke_remote(control_id, "x", ox::priority::high);
+
+	// bytes of the bulk frame which arrived before the control frame
+	std::size_t bulk_received = 0;
+
+	for (;;)
+	{
+		if (buffer.empty())
+		{
+			read_some();
+			continue;
+		}
+
+		if (static_cast<std::uint8_t>(buffer.front()) == ox::detail::fragment_marker)
+		{
+			ox::detail::fragment_header fragment;
+			auto result = ox::detail::parse_fragment_header(buffer.data(), buffer.data() + buffer.size(), fragment);
+
+			REQUIRE(result != ox::detail::parse_result::invalid);
+
+			if (result == ox::detail::parse_result::incomplete || fragment.size > buffer.size() - fragment.length)
+			{
+				read_some();
+				continue;
+			}
+
+			bulk_received += static_cast<std::size_t>(fragment.size);
+			buffer.erase(buffer.begin(), buffer.begin() + fragment.length + static_cast<std::size_t>(fragment.size));
+			continue;
+		}
+
+		ox::detail::frame_header header;
+		auto result = ox::detail::parse_header(buffer.data(), buffer.data() + buffer.size(), header);
+
+		REQUIRE(result != ox::detail::parse_result::invalid);
+
+		if (result == ox::detail::parse_result::incomplete || header.size > buffer.size() - header.length)
+		{
+			read_some();
+			continue;
+		}
+
+		CHECK(header.id == control_id);
+		CHECK(header.size == 1);
+		break;
+	}
+
+	// the control frame was sent between fragments of the bulk frame
+	CHECK(bulk_received > 0);
+	CHECK(bulk_received < bulk_size);
+
+	work.reset();
+	io_service.stop();
+	thread.join();
+}
@@ -0,0 +1,187 @@
+#include "wait_until.hpp"
+#include <catch.hpp>
+#include <cereal/types/vector.hpp>
+#include <future>
+#include <ox/ox.hpp>
+
+namespace
+{
+	struct point
+	{
+		int x;
+		int y;
+
+		template <class Archive>
+		void serialize(Archive& ar)
+		{
+			ar(x, y);
+		}
+	};
+
+	struct wide_point
+	{
+		long long x;
+		long long y;
+
+		template <class Archive>
+		void serialize(Archive& ar)
+		{
+			ar(x, y);
+		}
+	};
+
+	enum class color : std::uint8_t
+	{
+		red,
+		green,
+	};
+
+	// a mutually recursive pair, instantiated twice to hash it in both orders
+	template <int N>
+	struct mutual_second;
+
+	template <int N>
+	struct mutual_first
+	{
+		int value;
+		std::vector<mutual_second<N>> children;
+
+		template <class Archive>
+		void serialize(Archive& ar)
+		{
+			ar(value, children);
+		}
+	};
+
+	template <int N>
+	struct mutual_second
+	{
+		long long value;
+		std::vector<mutual_first<N>> children;
+
+		template <class Archive>
+		void serialize(Archive& ar)
+		{
+			ar(value, children);
+		}
+	};
+
+	struct node
+	{
+		int value;
+		std::vector<node> children;
+
+		template <class Archive>
+		void serialize(Archive& ar)
+		{
+			ar(value, children);
+		}
+	};
+}
+
+TEST_CASE("fingerprint")
+{
+	using ox::detail::fingerprint;
+
+	static_assert(fingerprint<std::function<void(int)>>() != fingerprint<std::function<void(long long)>>(), "");
+	static_assert(fingerprint<std::function<void(const std::string&)>>() == fingerprint<std::function<void(std::string)>>(), "");
+	static_assert(fingerprint<std::function<void(std::function<void(int)>)>>() != fingerprint<std::function<void(std::function<void(float)>)>>(), "");
+	static_assert(fingerprint<color>() == fingerprint<std::uint8_t>(), "");
+
+	CHECK(fingerprint<point>() == fingerprint<point>());
+	CHECK(fingerprint<point>() != fingerprint<wide_point>());
+	CHECK(fingerprint<std::vector<point>>() != fingerprint<std::vector<wide_point>>());
+
+	// recursive types are hashed with a back reference
+	CHECK(fingerprint<std::function<void(node)>>() == fingerprint<std::function<void(node)>>());
+	CHECK(fingerprint<node>() != fingerprint<point>());
+
+	// mutually recursive types hash the same whichever is hashed first
+	auto first = fingerprint<mutual_first<1>>();
+	auto second = fingerprint<mutual_second<1>>();
+
+	auto second_hashed_first = fingerprint<mutual_second<2>>();
+	auto first_hashed_second = fingerprint<mutual_first<2>>();
+
+	CHECK(first == first_hashed_second);
+	CHECK(second == second_hashed_first);
+	CHECK(first != second);
+}
+
+TEST_CASE("schema")
+{
+	ox::host host;
+
+	host.add<void(int, std::function<void(int)>)>("inc", [](auto x, auto f) {
+		f(x + 1);
+	});
+
+	auto context = std::make_shared<ox::client_context>();
+	context->enable_metrics();
+
+	using namespace std::chrono_literals;
+
+	// the host releases the receiver of a rejected call after its error
+	auto released = [&](std::int64_t live) {
+		return wait_until([&]() {
+			return context->metrics().live_callbacks == live;
+		});
+	};
+
+	SECTION("mismatch")
+	{
+		ox::client<void(const std::string&, std::function<void(int)>)> client(context, "localhost", 21872, "inc");
+
+		std::promise<boost::system::error_code> error;
+		auto f = error.get_future();
+
+		auto live = context->metrics().live_callbacks;
+
+		client("1", [](auto) {}, [&](const auto& ec) {
+			error.set_value(ec);
+		});
+
+		REQUIRE(f.wait_for(1s) == std::future_status::ready);
+		CHECK(f.get() == ox::errc::schema_mismatch);
+		CHECK(released(live));
+	}
+
+	SECTION("recursive")
+	{
+		host.add<void(node, std::function<void(int)>)>("count", [](const auto& tree, auto f) {
+			f(static_cast<int>(tree.children.size()));
+		});
+
+		ox::client<void(node, std::function<void(int)>)> client(context, "localhost", 21872, "count");
+
+		node tree{1, {node{2, {}}, node{3, {}}}};
+
+		std::promise<int> result;
+		auto f = result.get_future();
+
+		client(tree, [&](auto size) {
+			result.set_value(size);
+		});
+
+		REQUIRE(f.wait_for(1s) == std::future_status::ready);
+		CHECK(f.get() == 2);
+	}
+
+	SECTION("unknown")
+	{
+		ox::client<void(int, std::function<void(int)>)> client(context, "localhost", 21872, "dec");
+
+		std::promise<boost::system::error_code> error;
+		auto f = error.get_future();
+
+		auto live = context->metrics().live_callbacks;
+
+		client(1, [](auto) {}, [&](const auto& ec) {
+			error.set_value(ec);
+		});
+
+		REQUIRE(f.wait_for(1s) == std::future_status::ready);
+		CHECK(f.get() == ox::errc::unknown_service);
+		CHECK(released(live));
+	}
+}
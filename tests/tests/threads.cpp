@@ -0,0 +1,117 @@
+#include <atomic>
+#include <catch.hpp>
+#include <future>
+#include <mutex>
+#include <ox/detail/mpsc_queue.hpp>
+#include <ox/ox.hpp>
+#include <thread>
+#include <vector>
+
+TEST_CASE("threads")
+{
+	using namespace std::chrono_literals;
+
+	SECTION("the queue delivers every push once")
+	{
+		ox::detail::mpsc_queue<int> queue;
+
+		const int producers = 4;
+		const int n = 10000;
+
+		std::vector<std::thread> threads;
+
+		for (int t = 0; t < producers; ++t)
+		{
+			threads.emplace_back([&queue, t]() {
+				for (int i = 0; i < n; ++i)
+					queue.push(t * n + i);
+			});
+		}
+
+		std::vector<int> last(producers, -1);
+		int popped = 0;
+		bool ordered = true;
+
+		while (popped < producers * n)
+		{
+			int value;
+
+			if (!queue.pop(value))
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			// pushes of one producer keep their order
+			auto& previous = last[value / n];
+			ordered = ordered && value % n == previous + 1;
+			previous = value % n;
+			++popped;
+		}
+
+		for (auto& thread : threads)
+			thread.join();
+
+		int value;
+		CHECK_FALSE(queue.pop(value));
+		CHECK(ordered);
+	}
+
+	SECTION("calls from many threads are spread over the I/O threads")
+	{
+		using function_type = void(int, int, std::function<void(int)>);
+
+		std::mutex mutex;
+		std::vector<int> received(8, -1);
+		bool ordered = true;
+
+		ox::server<function_type> server([&](auto thread, auto index, auto f) {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				ordered = ordered && index == received[thread] + 1;
+				received[thread] = index;
+			}
+
+			f(index);
+		});
+
+		ox::io_options options;
+		options.threads = 4;
+
+		auto context = std::make_shared<ox::client_context>(options);
+		context->enable_metrics();
+
+		ox::client<function_type> client(context, "localhost");
+
+		const int n = 200;
+		std::atomic<int> completed(0);
+		std::promise<void> done;
+
+		std::vector<std::thread> threads;
+
+		for (int t = 0; t < 8; ++t)
+		{
+			threads.emplace_back([&, t]() {
+				for (int i = 0; i < n; ++i)
+				{
+					client(t, i, [&](auto /*index*/) {
+						if (++completed == 8 * n)
+							done.set_value();
+					});
+				}
+			});
+		}
+
+		for (auto& thread : threads)
+			thread.join();
+
+		REQUIRE(done.get_future().wait_for(10s) == std::future_status::ready);
+
+		// the callers are spread over all I/O threads, each of which opens its own connection
+		CHECK(context->metrics().connections_opened == options.threads);
+
+		// the calls of each thread arrive in the order they were made
+		std::lock_guard<std::mutex> lock(mutex);
+		CHECK(ordered);
+	}
+}
@@ -0,0 +1,129 @@
+#include "wait_until.hpp"
+#include <algorithm>
+#include <catch.hpp>
+#include <future>
+#include <ox/ox.hpp>
+#include <thread>
+
+TEST_CASE("trace")
+{
+	using function_type = void(int, std::function<void(int)>);
+
+	ox::server<function_type> server([](auto x, auto f) {
+		f(x + 1);
+	});
+
+	ox::client<function_type> client("localhost");
+
+	auto server_sink = std::make_shared<ox::ring_buffer_trace_sink>();
+	auto client_sink = std::make_shared<ox::ring_buffer_trace_sink>();
+
+	server.enable_tracing(server_sink);
+	client.enable_tracing(client_sink);
+
+	std::promise<int> result;
+	auto f = result.get_future();
+
+	client(1, [&](auto x) {
+		result.set_value(x);
+	});
+
+	using namespace std::chrono_literals;
+	REQUIRE(f.wait_for(1s) == std::future_status::ready);
+
+	CHECK(f.get() == 2);
+
+	// spans of write completions may still be in flight when the result arrives
+	std::this_thread::sleep_for(100ms);
+
+	auto client_spans = client_sink->spans();
+	auto server_spans = server_sink->spans();
+
+	auto find = [](const std::vector<ox::span>& spans, const std::string& name) {
+		return std::find_if(spans.begin(), spans.end(), [&](const auto& s) {
+			return s.name == name;
+		});
+	};
+
+	auto call = find(client_spans, "call");
+	REQUIRE(call != client_spans.end());
+	CHECK(call->parent_id == 0);
+
+	for (auto name : {"resolve", "connect", "handshake", "serialize"})
+	{
+		auto it = find(client_spans, name);
+		REQUIRE(it != client_spans.end());
+		CHECK(it->parent_id == call->span_id);
+	}
+
+	for (const auto& s : client_spans)
+		CHECK(s.trace_id == call->trace_id);
+
+	for (const auto& s : server_spans)
+		CHECK(s.trace_id == call->trace_id);
+
+	auto dispatch = find(server_spans, "dispatch");
+	REQUIRE(dispatch != server_spans.end());
+	CHECK(dispatch->parent_id == call->span_id);
+	CHECK(dispatch->start <= dispatch->end);
+
+	// the nested callback is dispatched under the span of the server's dispatch which invoked it
+	auto nested = find(client_spans, "dispatch");
+	REQUIRE(nested != client_spans.end());
+	CHECK(nested->parent_id == dispatch->span_id);
+}
+
+TEST_CASE("trace through an untraced hop")
+{
+	using function_type = void(int, std::function<void(int)>);
+
+	// the server does not trace, but passes the context of the call on to its callbacks
+	ox::server<function_type> server([](auto x, auto f) {
+		f(x + 1);
+	});
+
+	ox::client<function_type> client("localhost");
+
+	auto sink = std::make_shared<ox::ring_buffer_trace_sink>();
+	client.enable_tracing(sink);
+
+	std::promise<int> result;
+	auto f = result.get_future();
+
+	client(1, [&](auto x) {
+		result.set_value(x);
+	});
+
+	using namespace std::chrono_literals;
+	REQUIRE(f.wait_for(1s) == std::future_status::ready);
+
+	// the receiver and the reply are dispatched on the client
+	auto dispatches = [&]() {
+		auto spans = sink->spans();
+
+		return std::count_if(spans.begin(), spans.end(), [](const auto& s) {
+			return std::string(s.name) == "dispatch";
+		});
+	};
+
+	REQUIRE(wait_until([&]() {
+		return dispatches() >= 2;
+	}));
+
+	auto spans = sink->spans();
+
+	auto call = std::find_if(spans.begin(), spans.end(), [](const auto& s) {
+		return std::string(s.name) == "call";
+	});
+
+	REQUIRE(call != spans.end());
+
+	for (const auto& s : spans)
+		CHECK(s.trace_id == call->trace_id);
+
+	auto receiver = std::find_if(spans.begin(), spans.end(), [&](const auto& s) {
+		return std::string(s.name) == "dispatch" && s.parent_id == call->span_id;
+	});
+
+	CHECK(receiver != spans.end());
+}
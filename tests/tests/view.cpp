@@ -0,0 +1,81 @@
+#include <catch.hpp>
+#include <cereal/types/vector.hpp>
+#include <future>
+#include <numeric>
+#include <ox/ox.hpp>
+
+TEST_CASE("view")
+{
+	using view_type = void(ox::string_view, ox::array_view<const std::uint32_t>, std::function<void(ox::string_view, std::uint64_t)>);
+	using owning_type = void(const std::string&, const std::vector<std::uint32_t>&, std::function<void(const std::string&, std::uint64_t)>);
+
+	ox::host host;
+
+	host.add<view_type>("view", [](auto str, auto values, auto f) {
+		f(str, std::accumulate(values.begin(), values.end(), std::uint64_t(0)));
+	});
+
+	auto context = std::make_shared<ox::client_context>();
+
+	using namespace std::chrono_literals;
+
+	SECTION("views")
+	{
+		ox::client<view_type> client(context, "localhost", 21872, "view");
+
+		std::promise<std::pair<std::string, std::uint64_t>> result;
+		auto f = result.get_future();
+
+		{
+			// the arguments are copied before the call returns
+			std::string str = "abc";
+			std::vector<std::uint32_t> values = {1, 2, 3};
+
+			client(str, values, [&](auto str, auto sum) {
+				result.set_value(std::make_pair(str.to_string(), sum));
+			});
+		}
+
+		REQUIRE(f.wait_for(1s) == std::future_status::ready);
+
+		auto r = f.get();
+		CHECK(r.first == "abc");
+		CHECK(r.second == 6);
+	}
+
+	SECTION("owning")
+	{
+		ox::client<owning_type> client(context, "localhost", 21872, "view");
+
+		std::promise<std::pair<std::string, std::uint64_t>> result;
+		auto f = result.get_future();
+
+		client("xyz", {4, 5}, [&](auto str, auto sum) {
+			result.set_value(std::make_pair(str, sum));
+		});
+
+		REQUIRE(f.wait_for(1s) == std::future_status::ready);
+
+		auto r = f.get();
+		CHECK(r.first == "xyz");
+		CHECK(r.second == 9);
+	}
+
+	SECTION("vectors")
+	{
+		static_assert(std::is_constructible<ox::array_view<const int>, const std::vector<int>&>::value, "");
+		static_assert(std::is_constructible<ox::array_view<int>, std::vector<int>&>::value, "");
+		static_assert(!std::is_constructible<ox::array_view<int>, const std::vector<int>&>::value, "");
+
+		std::vector<int> values = {1, 2, 3};
+
+		ox::array_view<int> view(values);
+		view[0] = 4;
+
+		const auto& constant = values;
+		ox::array_view<const int> const_view(constant);
+
+		CHECK(const_view.size() == 3);
+		CHECK(const_view[0] == 4);
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <chrono>
+#include <thread>
+
+// polls predicate until it holds or timeout expires, and returns whether it held
+template <class Predicate>
+bool wait_until(Predicate predicate, std::chrono::steady_clock::duration timeout = std::chrono::seconds(2))
+{
+	auto deadline = std::chrono::steady_clock::now() + timeout;
+
+	while (!predicate())
+	{
+		if (std::chrono::steady_clock::now() >= deadline)
+			return predicate();
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	return true;
+}
@@ -0,0 +1,490 @@
+// Replays a capture taken on a host against a server and reports throughput and latency.
+// Usage: replay <capture> [host] [port] [speed]
+//
+// The frames which the host received are sent again with their recorded timing divided by
+// speed (0 sends them as fast as possible), one connection per captured connection.
+// Dispatch latency ends when the server invokes the receiver of a call, before its handler runs.
+// Reply latency runs from sending a frame which carries callbacks to the server invoking one of
+// them, which includes the handler. Callbacks are found by looking for the ids the host invoked
+// in the payloads of the frames it received. Frames addressed to callbacks of the server keep
+// their recorded ids, which match as long as the server registers callbacks in the same order
+// as during the capture.
+#include <algorithm>
+#include <atomic>
+#include <boost/asio.hpp>
+#include <boost/lexical_cast.hpp>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <ox/capture.hpp>
+#include <ox/detail/call.hpp>
+#include <ox/detail/frame.hpp>
+#include <ox/priority.hpp>
+#include <ox/service.hpp>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace
+{
+	using clock_type = std::chrono::steady_clock;
+
+	struct frame
+	{
+		std::chrono::nanoseconds time;
+		std::uint64_t connection;
+		std::uint64_t id;
+		std::vector<char> data;
+
+		// the callback id of the receiver if the frame is an initial call
+		std::uint64_t receiver = 0;
+		bool call = false;
+
+		// callbacks in the payload which the host invoked later
+		std::vector<std::uint64_t> replies;
+	};
+
+	// a callback travels as its 8 byte id and the byte of its lane
+	const std::size_t callback_size = sizeof(std::uint64_t) + 1;
+
+	template <class Function>
+	void for_each_callback(ox::string_view payload, Function function)
+	{
+		for (std::size_t i = 0; i + callback_size <= payload.size(); ++i)
+		{
+			if (static_cast<std::uint8_t>(payload[i + sizeof(std::uint64_t)]) >= ox::detail::priority_count)
+				continue;
+
+			std::uint64_t id;
+			std::memcpy(&id, payload.data() + i, sizeof(id));
+
+			if (!ox::service_id::is_reserved(id))
+				function(id);
+		}
+	}
+
+	struct statistics
+	{
+		std::uint64_t frames_sent = 0;
+		std::uint64_t bytes_sent = 0;
+		std::uint64_t frames_received = 0;
+		std::uint64_t calls = 0;
+		std::uint64_t replies = 0;
+		std::vector<double> dispatch_latencies;
+		std::vector<double> reply_latencies;
+
+		// frames addressed to callbacks which the server did not pass to the session
+		std::uint64_t unknown_frames = 0;
+		std::uint64_t unknown_ids = 0;
+	};
+
+	class session : public std::enable_shared_from_this<session>
+	{
+	public:
+		session(boost::asio::io_service& io_service, statistics& stats, std::atomic<std::uint64_t>& pending, const std::vector<std::shared_ptr<frame>>& frames, std::uint64_t connection)
+			: socket_(io_service)
+			, stats_(stats)
+			, pending_(pending)
+			, read_buffer_(64 * 1024)
+		{
+			for (const auto& f : frames)
+			{
+				if (f->connection == connection && !ox::service_id::is_reserved(f->id))
+					unknown_.emplace(f->id, 0);
+			}
+		}
+
+		boost::asio::ip::tcp::socket& socket()
+		{
+			return socket_;
+		}
+
+		void handshake()
+		{
+			boost::asio::write(socket_, boost::asio::buffer(ox::detail::get_signature()));
+
+			std::array<char, ox::detail::signature_size> signature;
+			boost::asio::read(socket_, boost::asio::buffer(signature));
+
+			if (signature != ox::detail::get_signature())
+				throw std::runtime_error("the server refused the connection");
+		}
+
+		void start()
+		{
+			read();
+		}
+
+		// called on the I/O thread once it is stopped
+		void finish()
+		{
+			for (const auto& unknown : unknown_)
+			{
+				++stats_.unknown_ids;
+				stats_.unknown_frames += unknown.second;
+			}
+		}
+
+		// called on the I/O thread
+		void send(const std::shared_ptr<frame>& f)
+		{
+			if (f->call)
+			{
+				calls_[f->receiver] = clock_type::now();
+				++stats_.calls;
+				++pending_;
+			}
+
+			for (auto id : f->replies)
+			{
+				replies_[id] = clock_type::now();
+				++stats_.replies;
+				++pending_;
+			}
+
+			auto unknown = unknown_.find(f->id);
+			if (unknown != unknown_.end())
+				++unknown->second;
+
+			++stats_.frames_sent;
+			stats_.bytes_sent += f->data.size();
+
+			queue_.push_back(f);
+
+			if (queue_.size() == 1)
+				write();
+		}
+
+	private:
+		void write()
+		{
+			auto self = shared_from_this();
+
+			boost::asio::async_write(socket_, boost::asio::buffer(queue_.front()->data), [self](const auto& ec, auto /*bytes_transferred*/) {
+				if (ec)
+					return;
+
+				self->queue_.pop_front();
+
+				if (!self->queue_.empty())
+					self->write();
+			});
+		}
+
+		void read()
+		{
+			if (read_begin_ != 0)
+			{
+				std::copy(read_buffer_.begin() + read_begin_, read_buffer_.begin() + read_end_, read_buffer_.begin());
+				read_end_ -= read_begin_;
+				read_begin_ = 0;
+			}
+
+			if (read_end_ == read_buffer_.size())
+				read_buffer_.resize(read_buffer_.size() * 2);
+
+			auto self = shared_from_this();
+
+			socket_.async_read_some(boost::asio::buffer(read_buffer_.data() + read_end_, read_buffer_.size() - read_end_), [self](const auto& ec, std::size_t bytes_transferred) {
+				if (ec)
+					return;
+
+				self->read_end_ += bytes_transferred;
+				self->process();
+			});
+		}
+
+		void process()
+		{
+			for (;;)
+			{
+				auto begin = read_buffer_.data() + read_begin_;
+				auto end = read_buffer_.data() + read_end_;
+
+				if (begin != end && static_cast<std::uint8_t>(*begin) == ox::detail::fragment_marker)
+				{
+					ox::detail::fragment_header fragment;
+
+					if (ox::detail::parse_fragment_header(begin, end, fragment) != ox::detail::parse_result::complete || fragment.size > static_cast<std::uint64_t>(end - begin) - fragment.length)
+						break;
+
+					auto& buffer = fragments_[fragment.stream];
+					buffer.insert(buffer.end(), begin + fragment.length, begin + fragment.length + fragment.size);
+
+					read_begin_ += fragment.length + static_cast<std::size_t>(fragment.size);
+
+					ox::detail::frame_header header;
+
+					if (ox::detail::parse_header(buffer.data(), buffer.data() + buffer.size(), header) == ox::detail::parse_result::complete && header.length + header.size == buffer.size())
+					{
+						received(header, ox::string_view(buffer.data() + header.length, buffer.size() - header.length));
+						fragments_.erase(fragment.stream);
+					}
+
+					continue;
+				}
+
+				ox::detail::frame_header header;
+
+				if (ox::detail::parse_header(begin, end, header) != ox::detail::parse_result::complete)
+					break;
+
+				auto size = header.size == std::numeric_limits<std::uint64_t>::max() ? 0 : header.size;
+
+				if (size > static_cast<std::uint64_t>(end - begin) - header.length)
+				{
+					// the buffer grows until the frame fits
+					if (header.length + size > read_buffer_.size())
+						read_buffer_.resize(static_cast<std::size_t>(header.length + size));
+
+					break;
+				}
+
+				read_begin_ += header.length + static_cast<std::size_t>(size);
+
+				if (size != header.size)
+					continue;
+
+				received(header, ox::string_view(begin + header.length, static_cast<std::size_t>(size)));
+			}
+
+			read();
+		}
+
+		void received(const ox::detail::frame_header& header, ox::string_view payload)
+		{
+			++stats_.frames_received;
+
+			// the server passed these callbacks, so frames addressed to them are not unknown
+			if (!unknown_.empty())
+			{
+				for_each_callback(payload, [this](std::uint64_t id) {
+					unknown_.erase(id);
+				});
+			}
+
+			answered(calls_, header.id, stats_.dispatch_latencies);
+			answered(replies_, header.id, stats_.reply_latencies);
+		}
+
+		void answered(std::unordered_map<std::uint64_t, clock_type::time_point>& sent, std::uint64_t id, std::vector<double>& latencies)
+		{
+			auto it = sent.find(id);
+			if (it == sent.end())
+				return;
+
+			latencies.push_back(std::chrono::duration<double, std::micro>(clock_type::now() - it->second).count());
+			sent.erase(it);
+			--pending_;
+		}
+
+		boost::asio::ip::tcp::socket socket_;
+		statistics& stats_;
+		std::atomic<std::uint64_t>& pending_;
+
+		std::deque<std::shared_ptr<frame>> queue_;
+
+		std::vector<char> read_buffer_;
+		std::size_t read_begin_ = 0;
+		std::size_t read_end_ = 0;
+		std::unordered_map<std::uint64_t, std::vector<char>> fragments_;
+
+		std::unordered_map<std::uint64_t, clock_type::time_point> calls_;
+		std::unordered_map<std::uint64_t, clock_type::time_point> replies_;
+
+		// callbacks of the server addressed by the capture and not yet seen in its frames, with the
+		// number of frames sent to them
+		std::unordered_map<std::uint64_t, std::uint64_t> unknown_;
+	};
+
+	std::vector<std::shared_ptr<frame>> load(const std::string& path)
+	{
+		std::vector<std::shared_ptr<frame>> result;
+		ox::captured_frame captured;
+
+		// when the host first invoked each callback of its peers, by connection
+		std::map<std::uint64_t, std::unordered_map<std::uint64_t, std::chrono::nanoseconds>> invoked;
+
+		ox::capture_reader invocations(path);
+
+		while (invocations.next(captured))
+		{
+			if (!captured.received && captured.size != std::numeric_limits<std::uint64_t>::max())
+				invoked[captured.connection].emplace(captured.id, captured.time);
+		}
+
+		ox::capture_reader reader(path);
+
+		while (reader.next(captured))
+		{
+			if (!captured.received)
+				continue;
+
+			auto f = std::make_shared<frame>();
+			f->time = captured.time;
+			f->connection = captured.connection;
+			f->id = captured.id;
+
+			ox::detail::write_integer(f->data, captured.id);
+			ox::detail::write_integer(f->data, captured.size);
+			f->data.insert(f->data.end(), captured.payload.begin(), captured.payload.end());
+
+			auto unregister = captured.size == std::numeric_limits<std::uint64_t>::max();
+
+			if (!unregister && ox::service_id::is_reserved(captured.id) && captured.payload.size() >= ox::detail::call_receiver_offset + sizeof(std::uint64_t))
+			{
+				std::memcpy(&f->receiver, captured.payload.data() + ox::detail::call_receiver_offset, sizeof(f->receiver));
+				f->call = true;
+			}
+
+			// the first frame carrying a callback before its invocation is taken as the one which
+			// registered it; receivers of calls count as dispatches instead
+			auto& callbacks = invoked[captured.connection];
+
+			if (f->call)
+				callbacks.erase(f->receiver);
+
+			if (!unregister)
+			{
+				for_each_callback(captured.payload, [&](std::uint64_t id) {
+					auto it = callbacks.find(id);
+
+					if (it != callbacks.end() && it->second >= f->time)
+					{
+						f->replies.push_back(id);
+						callbacks.erase(it);
+					}
+				});
+			}
+
+			result.push_back(f);
+		}
+
+		return result;
+	}
+
+	double percentile(std::vector<double>& values, double p)
+	{
+		if (values.empty())
+			return 0;
+
+		auto n = static_cast<std::size_t>(p * (values.size() - 1));
+		std::nth_element(values.begin(), values.begin() + n, values.end());
+
+		return values[n];
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "usage: " << argv[0] << " <capture> [host] [port] [speed]" << std::endl;
+		return 1;
+	}
+
+	std::string host = argc > 2 ? argv[2] : "localhost";
+	std::string port = argc > 3 ? argv[3] : "21872";
+	double speed = argc > 4 ? boost::lexical_cast<double>(argv[4]) : 1.0;
+
+	auto frames = load(argv[1]);
+
+	if (frames.empty())
+	{
+		std::cerr << "no frames received by the host in " << argv[1] << std::endl;
+		return 1;
+	}
+
+	boost::asio::io_service io_service;
+	statistics stats;
+	std::atomic<std::uint64_t> pending(0);
+
+	boost::asio::ip::tcp::resolver resolver(io_service);
+	auto endpoints = resolver.resolve(boost::asio::ip::tcp::resolver::query(host, port));
+
+	std::map<std::uint64_t, std::shared_ptr<session>> sessions;
+
+	for (const auto& f : frames)
+	{
+		auto& s = sessions[f->connection];
+
+		if (!s)
+		{
+			s = std::make_shared<session>(io_service, stats, pending, frames, f->connection);
+			boost::asio::connect(s->socket(), endpoints);
+			s->socket().set_option(boost::asio::ip::tcp::no_delay(true));
+			s->handshake();
+			s->start();
+		}
+	}
+
+	boost::asio::io_service::work work(io_service);
+	std::thread thread([&]() {
+		io_service.run();
+	});
+
+	auto start = clock_type::now();
+
+	for (const auto& f : frames)
+	{
+		if (speed > 0)
+			std::this_thread::sleep_until(start + std::chrono::duration_cast<clock_type::duration>(f->time / speed));
+
+		auto s = sessions[f->connection];
+
+		io_service.post([s, f]() {
+			s->send(f);
+		});
+	}
+
+	// waits for the answers to the calls and callbacks sent, but not forever
+	std::promise<void> sent;
+	io_service.post([&]() {
+		sent.set_value();
+	});
+	sent.get_future().wait();
+
+	auto deadline = clock_type::now() + std::chrono::seconds(5);
+
+	while (pending != 0 && clock_type::now() < deadline)
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	auto seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+
+	io_service.stop();
+	thread.join();
+
+	for (const auto& s : sessions)
+		s.second->finish();
+
+	auto answered = stats.dispatch_latencies.size();
+
+	std::cout
+		<< "connections: " << sessions.size() << "\n"
+		<< "frames sent: " << stats.frames_sent << " (" << stats.bytes_sent << " bytes), received: " << stats.frames_received << "\n"
+		<< "calls: " << stats.calls << ", dispatched: " << answered << ", replies: " << stats.replies << ", answered: " << stats.reply_latencies.size() << "\n"
+		<< "elapsed: " << seconds << " s, " << static_cast<std::uint64_t>(stats.frames_sent / seconds) << " frames/s, "
+		<< static_cast<std::uint64_t>(answered / seconds) << " calls/s\n"
+		<< "dispatch latency p50 " << percentile(stats.dispatch_latencies, 0.5) << " us, "
+		<< "p99 " << percentile(stats.dispatch_latencies, 0.99) << " us, "
+		<< "p999 " << percentile(stats.dispatch_latencies, 0.999) << " us\n"
+		<< "reply latency p50 " << percentile(stats.reply_latencies, 0.5) << " us, "
+		<< "p99 " << percentile(stats.reply_latencies, 0.99) << " us, "
+		<< "p999 " << percentile(stats.reply_latencies, 0.999) << " us"
+		<< std::endl;
+
+	if (stats.unknown_frames != 0)
+	{
+		std::cerr
+			<< "warning: " << stats.unknown_frames << " frames addressed " << stats.unknown_ids
+			<< " callbacks which the server never passed to the replay, which happens when the capture started on an open connection"
+			<< std::endl;
+	}
+
+	return 0;
+}